@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    Analyzer cost per second of audio with the high-rate decimation on and
+    off. Below 96 kHz it does nothing, so 48 kHz is the baseline.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "../../Source/PluginEditor.h"
+
+struct AnalyzerDecimationBenchmark : Benchmark
+{
+    AnalyzerDecimationBenchmark() : Benchmark("Analyzer decimation") {}
+
+    void run() override
+    {
+        constexpr int blockSize = 512;
+        const juce::Rectangle<float> fftBounds(0.f, 0.f, 800.f, 300.f);
+
+        for (auto sampleRate : { 48000.0, 96000.0, 192000.0 })
+        {
+            for (auto isDecimating : { true, false })
+            {
+                SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType> fifo(Channel::Left);
+                fifo.prepare(blockSize);
+
+                PathProducer pathProducer(fifo);
+                pathProducer.setHighRateDecimationEnabled(isDecimating);
+
+                //the fifo only holds a few blocks, so the analyzer runs after every one, like a fast editor timer would
+                const auto nanoseconds = measure(sampleRate, blockSize, [&](juce::AudioBuffer<float>& block)
+                    {
+                        fifo.update(block);
+                        pathProducer.process(fftBounds, sampleRate);
+                    });
+
+                report(juce::String((int)sampleRate) + " Hz, decimation " + (isDecimating ? "on" : "off"), nanoseconds, sampleRate);
+            }
+        }
+    }
+};
+
+static AnalyzerDecimationBenchmark analyzerDecimationBenchmark;
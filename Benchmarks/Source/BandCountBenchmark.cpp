@@ -0,0 +1,34 @@
+/*
+  ==============================================================================
+
+    BandEngine cost against the number of enabled bands. Only active
+    stages are processed, so this should grow linearly from zero.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+struct BandCountBenchmark : Benchmark
+{
+    BandCountBenchmark() : Benchmark("Bands") {}
+
+    void run() override
+    {
+        for (int numBands : { 0, 1, 2, 4, 8, 16 })
+        {
+            TestRendering::ParameterValues values;
+
+            //bells with some gain, so none of them is skipped as neutral
+            for (int i = 0; i < numBands; ++i)
+            {
+                values.push_back({ TestRendering::getBandID(i, Parameters::BandEnable), 1.f });
+                values.push_back({ TestRendering::getBandID(i, Parameters::BandGain), 3.f });
+            }
+
+            report(juce::String(numBands) + " enabled", measureProcessor(values), 48000.0);
+        }
+    }
+};
+
+static BandCountBenchmark bandCountBenchmark;
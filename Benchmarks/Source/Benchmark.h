@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    A minimal benchmark harness. Each Benchmark registers itself, like a
+    juce::UnitTest, and main() runs them and prints one line per result.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../../Tests/Source/TestRendering.h"
+#include <iostream>
+
+struct Benchmark
+{
+    explicit Benchmark(const juce::String& benchmarkName) : name(benchmarkName) { getAll().push_back(this); }
+    virtual ~Benchmark() = default;
+
+    virtual void run() = 0;
+
+    const juce::String name;
+
+    static std::vector<Benchmark*>& getAll()
+    {
+        static std::vector<Benchmark*> benchmarks;
+        return benchmarks;
+    }
+
+    //seconds of audio each measurement processes; set by main()
+    static double& getSecondsPerMeasurement()
+    {
+        static double seconds = 2.0;
+        return seconds;
+    }
+
+protected:
+    //prints the cost per sample frame, and how many times faster than realtime that is
+    void report(const juce::String& label, double nanosecondsPerSample, double sampleRate) const
+    {
+        const auto realtimeFactor = 1.0e9 / (nanosecondsPerSample * sampleRate);
+        std::cout << (name + ": " + label).paddedRight(' ', 56)
+                  << juce::String(nanosecondsPerSample, 1).paddedLeft(' ', 9) << " ns/sample"
+                  << juce::String(realtimeFactor, 0).paddedLeft(' ', 9) << "x realtime" << std::endl;
+    }
+
+    /*
+     Times 'processBlock' over getSecondsPerMeasurement() of audio in blocks of 'blockSize' and returns the
+     fastest of five runs in nanoseconds per sample frame. Each block is refilled from the same stereo noise
+     first, so the filters never settle into silence (and the silence sleep); that copy is part of the time.
+     */
+    template<typename ProcessBlock>
+    static double measure(double sampleRate, int blockSize, ProcessBlock&& processBlock)
+    {
+        const auto noise = TestRendering::makeSignal(TestRendering::Signal::Noise, sampleRate, blockSize);
+        juce::AudioBuffer<float> block(noise.getNumChannels(), blockSize);
+
+        const auto numBlocks = juce::jmax(1, juce::roundToInt(getSecondsPerMeasurement() * sampleRate / blockSize));
+        auto best = std::numeric_limits<double>::max();
+
+        for (int run = 0; run < 6; ++run)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                block.makeCopyOf(noise, true);
+                processBlock(block);
+            }
+
+            const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            //the first run only warms up the caches and the branch predictors
+            if (run > 0)
+                best = juce::jmin(best, seconds);
+        }
+
+        return best * 1.0e9 / ((double)numBlocks * blockSize);
+    }
+
+    //the processor with 'values' set, timed at 48 kHz in blocks of 512
+    static double measureProcessor(const TestRendering::ParameterValues& values, double sampleRate = 48000.0, bool isOffline = false)
+    {
+        constexpr int blockSize = 512;
+
+        SimpleEQAudioProcessor processor;
+        TestRendering::setParameters(processor, values);
+        TestRendering::prepare(processor, sampleRate, blockSize, isOffline);
+
+        juce::MidiBuffer midi;
+        return measure(sampleRate, blockSize, [&](juce::AudioBuffer<float>& block) { processor.processBlock(block, midi); });
+    }
+};
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    Low cut cost against its slope, for every family. Each 12 dB/oct is one
+    more biquad, so this should grow with the order.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+struct CutOrderBenchmark : Benchmark
+{
+    CutOrderBenchmark() : Benchmark("Cut order") {}
+
+    void run() override
+    {
+        const std::pair<CutFamily, const char*> families[] = { { Butterworth, "Butterworth" }, { LinkwitzRiley, "Linkwitz-Riley" },
+                                                               { Bessel, "Bessel" }, { Elliptic, "Elliptic" } };
+        const std::pair<Shape, const char*> shapes[] = { { Shape_12, "12" }, { Shape_24, "24" }, { Shape_36, "36" },
+                                                         { Shape_48, "48" }, { Shape_72, "72" }, { Shape_96, "96" } };
+
+        for (const auto& [family, familyName] : families)
+        {
+            for (const auto& [shape, slope] : shapes)
+            {
+                const TestRendering::ParameterValues values = { { Parameters::getID(Parameters::LowCutFreq), 100.f },
+                                                                { Parameters::getID(Parameters::LowCutShape), (float)getSlopeChoice(shape) },
+                                                                { Parameters::getID(Parameters::LowCutExtendedSlope), (float)getExtendedSlopeChoice(shape) },
+                                                                { Parameters::getID(Parameters::LowCutType), (float)family } };
+
+                report(juce::String(familyName) + ", " + slope + " dB/oct", measureProcessor(values), 48000.0);
+            }
+        }
+    }
+};
+
+static CutOrderBenchmark cutOrderBenchmark;
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    What the dynamic peak costs on top of the static one: the detector,
+    and redesigning the peak as its gain moves.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+struct DynamicPeakBenchmark : Benchmark
+{
+    DynamicPeakBenchmark() : Benchmark("Dynamic peak") {}
+
+    void run() override
+    {
+        auto id = [](Parameters::ID parameter) { return Parameters::getID(parameter); };
+
+        const TestRendering::ParameterValues staticPeak = { { id(Parameters::PeakFreq), 1000.f }, { id(Parameters::PeakGain), 6.f },
+                                                            { id(Parameters::PeakQ), 1.5f } };
+
+        //a low threshold keeps the detector working on the noise, so the gain keeps moving
+        auto dynamicPeak = staticPeak;
+        dynamicPeak.insert(dynamicPeak.end(), { { id(Parameters::PeakDynamic), 1.f }, { id(Parameters::PeakThreshold), -40.f },
+                                                { id(Parameters::PeakRatio), 4.f }, { id(Parameters::PeakAttack), 5.f },
+                                                { id(Parameters::PeakRelease), 50.f } });
+
+        for (auto isOffline : { false, true })
+        {
+            const juce::String engine = isOffline ? "offline, " : "realtime, ";
+            report(engine + "static", measureProcessor(staticPeak, 48000.0, isOffline), 48000.0);
+            report(engine + "dynamic", measureProcessor(dynamicPeak, 48000.0, isOffline), 48000.0);
+        }
+    }
+};
+
+static DynamicPeakBenchmark dynamicPeakBenchmark;
@@ -0,0 +1,35 @@
+/*
+  ==============================================================================
+
+    Headless CPU benchmarks for the SimpleEQ processor.
+
+    SimpleEQBenchmarks                  runs every benchmark
+      --filter=<text>                   only those whose name contains it
+      --seconds=<n>                     seconds of audio per measurement (default 2)
+
+    Build it in Release: the numbers are meant for comparing changes on the
+    same machine, not as absolute figures.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+int main(int argc, char* argv[])
+{
+    //the processor posts async updates, so it needs a message manager even without a GUI
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--seconds"))
+        Benchmark::getSecondsPerMeasurement() = juce::jmax(0.01, args.getValueForOption("--seconds").getDoubleValue());
+
+    const auto filter = args.getValueForOption("--filter");
+
+    for (auto* benchmark : Benchmark::getAll())
+        if (filter.isEmpty() || benchmark->name.containsIgnoreCase(filter))
+            benchmark->run();
+
+    return 0;
+}
@@ -109,6 +109,24 @@ void LookAndFeel::drawToggleButton(juce::Graphics& g,
 
         g.strokePath(analyzerButton->randomPath, PathStrokeType(1.f));
     }
+    else if (dynamic_cast<SpectrogramButton*>(&toggleButton) != nullptr)
+    {
+        auto color = ! toggleButton.getToggleState() ? Colours::dimgrey : Colours::green;
+        g.setColour(color);
+
+        auto bounds = toggleButton.getLocalBounds();
+        g.drawRect(bounds);
+
+        //a few stacked bands hint at a waterfall
+        auto insetRect = bounds.reduced(4).toFloat();
+        auto bandHeight = insetRect.getHeight() / 3.f;
+        for (int i = 0; i < 3; ++i)
+        {
+            g.setOpacity(0.3f + 0.3f * (float)i);
+            g.fillRect(insetRect.removeFromTop(bandHeight).reduced(0.f, 1.f));
+        }
+        g.setOpacity(1.f);
+    }
 
 
 }
@@ -220,63 +238,692 @@ juce::String RotarySliderWithLabels::getDisplayString() const
     return str;
 }
 //==============================================================================
-ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) : 
-audioProcessor(p),
-leftPathProducer(audioProcessor.leftChannelFifo),
-rightPathProducer(audioProcessor.rightChannelFifo)
+HalfBandDecimator::HalfBandDecimator(int sideTaps) :
+numSideTaps(juce::jmax(1, sideTaps)),
+length(4 * numSideTaps - 1),
+centre(length / 2),
+coefficients((size_t)numSideTaps),
+history(2 * (size_t)length)
 {
-    const auto& params = audioProcessor.getParameters();
-    for (auto param : params)
+    //windowed sinc: h[k] = sin(pi k / 2) / (pi k) for odd k, with a Blackman window over the full length
+    for (int i = 0; i < numSideTaps; ++i)
     {
-        param->addListener(this);
+        const auto k = 2 * i + 1;
+        const auto sinc = std::sin(juce::MathConstants<double>::halfPi * k) / (juce::MathConstants<double>::pi * k);
+        const auto phase = juce::MathConstants<double>::pi * k / (centre + 1);
+        const auto window = 0.42 + 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+
+        coefficients[(size_t)i] = (float)(sinc * window);
     }
 
-    updateChain();
-    startTimerHz(60);
+    reset();
 }
 
-ResponseCurveComponent::~ResponseCurveComponent()
+void HalfBandDecimator::reset()
+{
+    std::fill(history.begin(), history.end(), 0.f);
+    writeIndex = 0;
+    isOddSample = false;
+}
+
+int HalfBandDecimator::process(const float* input, int numSamples, float* output)
 {
-    const auto& params = audioProcessor.getParameters();
-    for (auto param : params)
+    int numWritten = 0;
+
+    for (int i = 0; i < numSamples; ++i)
     {
-        param->removeListener(this);
+        history[(size_t)writeIndex] = history[(size_t)(writeIndex + length)] = input[i];
+
+        if (++writeIndex == length)
+            writeIndex = 0;
+
+        isOddSample = !isOddSample;
+
+        if (isOddSample)
+            continue;
+
+        //the newest 'length' samples, oldest first
+        const auto* x = history.data() + writeIndex;
+
+        auto sum = 0.5f * x[centre];
+
+        for (int t = 0; t < numSideTaps; ++t)
+        {
+            const auto offset = 2 * t + 1;
+            sum += coefficients[(size_t)t] * (x[centre - offset] + x[centre + offset]);
+        }
+
+        output[numWritten++] = sum;
     }
-    
+
+    return numWritten;
+}
+//==============================================================================
+void SpectrumSmoother::setSettings(const Settings& newSettings)
+{
+    //a new averaging or hold setting starts from the next frame rather than blending with the old state
+    if (newSettings.averagingTimeMs != settings.averagingTimeMs || newSettings.peakHold != settings.peakHold)
+        hasHistory = false;
+
+    settings = newSettings;
+}
+
+void SpectrumSmoother::reset()
+{
+    hasHistory = false;
 }
 
-void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float newValue)
+void SpectrumSmoother::updateKernels(int fftSize)
 {
-    parametersChanged.set(true);
+    const auto numBins = fftSize / 2;
+
+    kernelStart.resize((size_t)numBins);
+    kernelEnd.resize((size_t)numBins);
+    kernelScale.resize((size_t)numBins);
+    runningSum.resize((size_t)numBins + 1);
+    average.resize((size_t)numBins);
+
+    auto fraction = 0.0;
+    switch (settings.smoothing)
+    {
+        case OctaveSmoothing::None:         fraction = 0.0;        break;
+        case OctaveSmoothing::Third:        fraction = 1.0 / 3.0;  break;
+        case OctaveSmoothing::Sixth:        fraction = 1.0 / 6.0;  break;
+        case OctaveSmoothing::Twelfth:      fraction = 1.0 / 12.0; break;
+        case OctaveSmoothing::TwentyFourth: fraction = 1.0 / 24.0; break;
+    }
 
+    const auto halfWidth = std::pow(2.0, fraction / 2.0);
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        //always contains bin k itself, so narrow kernels at the bottom fall back to no smoothing
+        auto start = juce::jlimit(0, k, (int)std::round(k / halfWidth));
+        auto end = juce::jlimit(k + 1, numBins, (int)std::round(k * halfWidth) + 1);
+
+        kernelStart[(size_t)k] = start;
+        kernelEnd[(size_t)k] = end;
+        kernelScale[(size_t)k] = 1.f / (float)(end - start);
+    }
+
+    kernelFFTSize = fftSize;
+    kernelSmoothing = settings.smoothing;
+    hasHistory = false;
 }
 
-void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
+void SpectrumSmoother::process(std::vector<float>& renderData, int fftSize, double frameSeconds, float negativeInfinity)
 {
-    juce::AudioBuffer<float> tempIncomingBuffer;
+    const auto isAveraging = settings.averagingTimeMs > 0.f;
 
-    while (leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
+    if (settings.smoothing == OctaveSmoothing::None && !isAveraging && !settings.peakHold)
     {
-        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer))
+        peaks.clear();
+        return;
+    }
+
+    if (fftSize != kernelFFTSize || settings.smoothing != kernelSmoothing)
+        updateKernels(fftSize);
+
+    const auto numBins = fftSize / 2;
+    jassert(renderData.size() >= (size_t)numBins);
+
+    //everything is averaged as power; the dB values are magnitudes, so power is 10^(dB / 10)
+    runningSum[0] = 0.0;
+    for (int k = 0; k < numBins; ++k)
+        runningSum[(size_t)k + 1] = runningSum[(size_t)k] + std::pow(10.0, renderData[(size_t)k] * 0.1);
+
+    const auto alpha = (isAveraging && hasHistory)
+        ? (float)(1.0 - std::exp(-frameSeconds * 1000.0 / settings.averagingTimeMs))
+        : 1.f;
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        const auto i = (size_t)k;
+        const auto power = (float)(runningSum[(size_t)kernelEnd[i]] - runningSum[(size_t)kernelStart[i]]) * kernelScale[i];
+
+        average[i] = alpha < 1.f ? average[i] + alpha * (power - average[i]) : power;
+        renderData[i] = juce::jmax(negativeInfinity, 10.f * std::log10(juce::jmax(average[i], 1.0e-20f)));
+    }
+
+    if (settings.peakHold)
+    {
+        const auto decay = (float)(settings.peakDecayDbPerSecond * frameSeconds);
+
+        if (!hasHistory || peaks.size() != renderData.size())
+            peaks.assign(renderData.size(), negativeInfinity);
+
+        for (int k = 0; k < numBins; ++k)
         {
-            auto size = tempIncomingBuffer.getNumSamples();
+            const auto i = (size_t)k;
+            peaks[i] = juce::jmax(renderData[i], peaks[i] - decay);
+        }
+    }
+    else
+    {
+        peaks.clear();
+    }
+
+    hasHistory = true;
+}
+//==============================================================================
+SpectrogramImage::SpectrogramImage()
+{
+    using namespace juce;
+
+    //quiet -> loud
+    const Colour stops[] { Colours::black, Colour(40u, 30u, 90u), Colour(133u, 115u, 161u), Colours::orange, Colours::white };
+    const int numSegments = (int)std::size(stops) - 1;
+
+    for (int i = 0; i < lutSize; ++i)
+    {
+        auto pos = (float)i / (float)(lutSize - 1) * (float)numSegments;
+        auto segment = jmin((int)pos, numSegments - 1);
+        colourLut[(size_t)i] = stops[segment].interpolatedWith(stops[segment + 1], pos - (float)segment);
+    }
+}
+
+void SpectrogramImage::prepare(int numColumns, int height)
+{
+    using namespace juce;
+
+    if (numColumns <= 0 || height <= 0)
+    {
+        release();
+        return;
+    }
+
+    if (image.getWidth() == numColumns && image.getHeight() == height)
+        return;
+
+    image = Image(Image::PixelFormat::RGB, numColumns, height, true);
+    writeColumn = 0;
+    mappedFFTSize = 0;
+}
+
+void SpectrogramImage::release()
+{
+    image = {};
+    binForRow.clear();
+    binForRow.shrink_to_fit();
+    mappedFFTSize = 0;
+}
+
+void SpectrogramImage::updateBinMapping(int fftSize, double sampleRate)
+{
+    using namespace juce;
+
+    auto height = image.getHeight();
+    auto numBins = fftSize / 2;
+    auto binWidth = sampleRate / (double)fftSize;
+
+    binForRow.resize((size_t)height);
+    for (int y = 0; y < height; ++y)
+    {
+        //top row is 20kHz, bottom row is 20Hz
+        auto freq = mapToLog10(1.0 - (double)y / (double)jmax(1, height - 1), 20.0, 20000.0);
+        binForRow[(size_t)y] = jlimit(0, numBins - 1, roundToInt(freq / binWidth));
+    }
+
+    mappedFFTSize = fftSize;
+    mappedSampleRate = sampleRate;
+}
+
+void SpectrogramImage::addFrame(const std::vector<float>& renderData, int fftSize, double sampleRate, float negativeInfinity)
+{
+    using namespace juce;
+
+    if (!isPrepared())
+        return;
+
+    if (fftSize != mappedFFTSize || sampleRate != mappedSampleRate || (int)binForRow.size() != image.getHeight())
+        updateBinMapping(fftSize, sampleRate);
+
+    const auto scale = (float)(lutSize - 1) / -negativeInfinity;
+
+    Image::BitmapData column(image, writeColumn, 0, 1, image.getHeight(), Image::BitmapData::writeOnly);
+    for (int y = 0; y < image.getHeight(); ++y)
+    {
+        auto level = renderData[(size_t)binForRow[(size_t)y]] - negativeInfinity;
+        auto index = jlimit(0, lutSize - 1, (int)(level * scale));
+        column.setPixelColour(0, y, colourLut[(size_t)index]);
+    }
+
+    if (++writeColumn == image.getWidth())
+        writeColumn = 0;
+}
+
+void SpectrogramImage::draw(juce::Graphics& g, juce::Rectangle<int> area) const
+{
+    if (!isPrepared())
+        return;
+
+    //oldest column is at writeColumn, so draw [writeColumn, width) first, then [0, writeColumn)
+    const auto width = image.getWidth();
+    const auto height = image.getHeight();
+    const auto olderWidth = width - writeColumn;
+
+    g.drawImage(image, area.getX(), area.getY(), olderWidth, area.getHeight(),
+        writeColumn, 0, olderWidth, height);
+
+    if (writeColumn > 0)
+        g.drawImage(image, area.getX() + olderWidth, area.getY(), writeColumn, area.getHeight(),
+            0, 0, writeColumn, height);
+}
+//==============================================================================
+AnalyzerCapture::AnalyzerCapture() : juce::Thread("SimpleEQ analyzer capture")
+{
+}
+
+AnalyzerCapture::~AnalyzerCapture()
+{
+    stop();
+}
+
+bool AnalyzerCapture::start(const juce::File& file, int channel)
+{
+    stop();
+
+    captureFile = file;
+    if (!captureFile.deleteFile() || captureFile.create().failed())
+        return false;
+
+    header = Header();
+    header.channel = (juce::uint32)channel;
+    writePosition = 0;
+    ring.reset();
+    numDropped.store(0);
+
+    return startThread();
+}
+
+void AnalyzerCapture::stop()
+{
+    if (!isThreadRunning())
+        return;
+
+    //the thread writes whatever is still queued before it returns
+    signalThreadShouldExit();
+    notify();
+    stopThread(5000);
+
+    mapping.reset();
+
+    //cut off the unused part of the last chunk
+    if (writePosition > 0)
+    {
+        juce::FileOutputStream out(captureFile);
+        if (out.openedOk())
+        {
+            out.setPosition(writePosition);
+            out.truncate();
+        }
+    }
+}
+
+void AnalyzerCapture::pushFrame(const std::vector<float>& decibels, int fftSize, double sampleRate, double timeInSeconds, float negativeInfinity)
+{
+    if (!isThreadRunning())
+        return;
+
+    //the first frame fixes the format; the writer only looks at the header once frames have been queued
+    if (header.fftSize == 0)
+    {
+        header.fftSize = (juce::uint32)fftSize;
+        header.numBins = (juce::uint32)(fftSize / 2);
+        header.sampleRate = sampleRate;
+        header.negativeInfinity = negativeInfinity;
+
+        ringFrames.assign((size_t)ringCapacity * header.numBins, 0.f);
+        ringTimes.assign((size_t)ringCapacity, 0.0);
+        firstFrameTime = timeInSeconds;
+    }
+
+    if ((juce::uint32)fftSize != header.fftSize || sampleRate != header.sampleRate || decibels.size() < header.numBins)
+    {
+        ++numDropped;
+        return;
+    }
+
+    const auto scope = ring.write(1);
+    if (scope.blockSize1 == 0)
+    {
+        ++numDropped;
+        return;
+    }
+
+    const auto index = (size_t)scope.startIndex1;
+    std::copy(decibels.begin(), decibels.begin() + header.numBins, ringFrames.begin() + (std::ptrdiff_t)(index * header.numBins));
+    ringTimes[index] = timeInSeconds - firstFrameTime;
+
+    notify();
+}
+
+bool AnalyzerCapture::reserve(juce::int64 size)
+{
+    if (mapping != nullptr && (juce::int64)mapping->getSize() >= size)
+        return true;
+
+    mapping.reset();
+
+    //grow the file by whole chunks so remapping is rare
+    const auto newSize = (size + growthSize - 1) / growthSize * growthSize;
+    {
+        juce::FileOutputStream out(captureFile);
+        if (!out.openedOk() || !out.setPosition(newSize - 1) || !out.writeByte(0))
+            return false;
+    }
+
+    mapping = std::make_unique<juce::MemoryMappedFile>(captureFile, juce::MemoryMappedFile::readWrite);
+    return mapping->getData() != nullptr && (juce::int64)mapping->getSize() >= size;
+}
+
+void AnalyzerCapture::writePendingFrames()
+{
+    const auto numReady = ring.getNumReady();
+    if (numReady == 0)
+        return;
+
+    const auto recordSize = (juce::int64)getRecordSize();
+
+    if (writePosition == 0)
+        writePosition = (juce::int64)sizeof(Header);
+
+    if (!reserve(writePosition + numReady * recordSize))
+    {
+        //can't grow the file: throw the frames away rather than letting the ring stall
+        ring.read(numReady);
+        numDropped += numReady;
+        return;
+    }
+
+    auto* data = static_cast<char*>(mapping->getData());
+    const auto scope = ring.read(numReady);
+
+    auto writeRecords = [&](int start, int count)
+        {
+            for (int i = start; i < start + count; ++i)
+            {
+                auto* record = data + writePosition;
+                std::memcpy(record, &ringTimes[(size_t)i], sizeof(double));
+                std::memcpy(record + sizeof(double), ringFrames.data() + (size_t)i * header.numBins, header.numBins * sizeof(float));
+                writePosition += recordSize;
+            }
+        };
+
+    writeRecords(scope.startIndex1, scope.blockSize1);
+    writeRecords(scope.startIndex2, scope.blockSize2);
+
+    header.numFrames += (juce::uint64)numReady;
+    std::memcpy(data, &header, sizeof(Header));
+}
+
+void AnalyzerCapture::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(100);
+        writePendingFrames();
+    }
+
+    writePendingFrames();
+}
+//==============================================================================
+bool AnalyzerCaptureReader::open(const juce::File& file)
+{
+    mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    numFrames = 0;
+
+    if (mapping->getData() == nullptr || mapping->getSize() < sizeof(AnalyzerCapture::Header))
+        return false;
+
+    std::memcpy(&header, mapping->getData(), sizeof(AnalyzerCapture::Header));
+
+    if (std::memcmp(header.magic, "SEQC", 4) != 0 || header.version != 1 || header.numBins == 0)
+        return false;
+
+    recordSize = sizeof(double) + header.numBins * sizeof(float);
+
+    //trust the frame count only as far as the file actually reaches
+    const auto numComplete = (juce::int64)((mapping->getSize() - sizeof(AnalyzerCapture::Header)) / recordSize);
+    numFrames = juce::jmin((juce::int64)header.numFrames, numComplete);
+    return true;
+}
+
+const char* AnalyzerCaptureReader::getRecord(juce::int64 frameIndex) const
+{
+    jassert(frameIndex >= 0 && frameIndex < numFrames);
+    return static_cast<const char*>(mapping->getData()) + sizeof(AnalyzerCapture::Header) + (size_t)frameIndex * recordSize;
+}
+
+double AnalyzerCaptureReader::getFrameTime(juce::int64 frameIndex) const
+{
+    //records aren't necessarily 8-byte aligned
+    double time;
+    std::memcpy(&time, getRecord(frameIndex), sizeof(double));
+    return time;
+}
+
+const float* AnalyzerCaptureReader::getFrame(juce::int64 frameIndex) const
+{
+    return reinterpret_cast<const float*>(getRecord(frameIndex) + sizeof(double));
+}
+
+bool AnalyzerCaptureReader::exportCsv(const juce::File& destination) const
+{
+    if (numFrames == 0)
+        return false;
+
+    destination.deleteFile();
+    juce::FileOutputStream out(destination);
+    if (!out.openedOk())
+        return false;
+
+    const auto binWidth = header.sampleRate / header.fftSize;
+
+    out << "time";
+    for (juce::uint32 bin = 0; bin < header.numBins; ++bin)
+        out << "," << juce::String(bin * binWidth, 1);
+    out << "\n";
+
+    for (juce::int64 i = 0; i < numFrames; ++i)
+    {
+        const auto* frame = getFrame(i);
+
+        out << juce::String(getFrameTime(i), 6);
+        for (juce::uint32 bin = 0; bin < header.numBins; ++bin)
+            out << "," << juce::String(frame[bin], 2);
+        out << "\n";
+    }
+
+    out.flush();
+    return out.getStatus().wasOk();
+}
+
+juce::Image AnalyzerCaptureReader::renderImage(int maxWidth, int height) const
+{
+    if (numFrames == 0 || maxWidth <= 0 || height <= 0)
+        return {};
+
+    const auto width = (int)juce::jmin((juce::int64)maxWidth, numFrames);
+    juce::Image image(juce::Image::RGB, width, height, false);
+
+    //same log axis as the line analyzer, top row highest
+    const auto binWidth = header.sampleRate / header.fftSize;
+    std::vector<int> binForRow((size_t)height);
+    for (int row = 0; row < height; ++row)
+    {
+        const auto frequency = juce::mapToLog10(1.0 - (row + 0.5) / height, 20.0, 20000.0);
+        binForRow[(size_t)row] = juce::jlimit(0, (int)header.numBins - 1, juce::roundToInt(frequency / binWidth));
+    }
+
+    for (int x = 0; x < width; ++x)
+    {
+        const auto* frame = getFrame(numFrames * x / width);
+
+        for (int row = 0; row < height; ++row)
+        {
+            const auto level = juce::jmap(frame[binForRow[(size_t)row]], header.negativeInfinity, 0.f, 0.f, 1.f);
+            image.setPixelAt(x, row, juce::Colour::greyLevel(juce::jlimit(0.f, 1.f, level)));
+        }
+    }
+
+    return image;
+}
+
+bool AnalyzerCaptureReader::exportImage(const juce::File& destination, int maxWidth, int height) const
+{
+    auto image = renderImage(maxWidth, height);
+    if (!image.isValid())
+        return false;
+
+    destination.deleteFile();
+    juce::FileOutputStream out(destination);
+
+    juce::PNGImageFormat png;
+    return out.openedOk() && png.writeImageToStream(image, out);
+}
+//==============================================================================
+ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) : 
+audioProcessor(p),
+analyzerFifos(audioProcessor.acquireAnalyzerFifos()),
+leftPathProducer(analyzerFifos.leftChannelFifo),
+rightPathProducer(analyzerFifos.rightChannelFifo),
+keyPathProducer(analyzerFifos.keyChannelFifo)
+{
+    audioProcessor.chainCoefficients.update();
+    startTimerHz(60);
+}
+
+ResponseCurveComponent::~ResponseCurveComponent()
+{
+    stopTimer();
+    stopCapture();
+    audioProcessor.releaseAnalyzerFifos();
+}
+
+int PathProducer::getNumFrontDecimationStages(double sampleRate) const
+{
+    if (!shouldDecimateHighRates)
+        return 0;
+
+    int numStages = 0;
+
+    //88.2 and 176.4kHz come down to 44.1kHz, 96 and 192kHz to 48kHz
+    while (numStages < maxFrontDecimationStages && sampleRate / (double)(1 << numStages) > 48000.0 * 1.01)
+        ++numStages;
+
+    return numStages;
+}
+
+void PathProducer::prepareFrontDecimation(int numStages)
+{
+    frontDecimators.clear();
+
+    for (int i = 0; i < numStages; ++i)
+        frontDecimators.emplace_back(i == numStages - 1 ? finalFrontDecimatorSideTaps : 8);
+
+    //what is already buffered was captured at the old rate
+    monoBuffer.clear();
+    lowBandBuffer.clear();
+
+    for (auto& decimator : lowBandDecimators)
+        decimator.reset();
+
+    numFrontDecimationStages = numStages;
+}
+
+void PathProducer::process(juce::Rectangle<float> fftBounds, double hostSampleRate)
+{
+    const auto numStages = getNumFrontDecimationStages(hostSampleRate);
+
+    if (numStages != numFrontDecimationStages)
+        prepareFrontDecimation(numStages);
+
+    //everything after the front decimators runs at this rate
+    const auto sampleRate = hostSampleRate / (double)(1 << numFrontDecimationStages);
+
+    auto shiftIn = [](juce::AudioBuffer<float>& buffer, const float* samples, int size)
+        {
+            //only the newest samples matter if more arrive than the buffer holds
+            const auto numToSkip = juce::jmax(0, size - buffer.getNumSamples());
+            size -= numToSkip;
+
+            if (size <= 0)
+                return;
 
             juce::FloatVectorOperations::copy(
-                monoBuffer.getWritePointer(0, 0),
-                monoBuffer.getReadPointer(0, size),
-                monoBuffer.getNumSamples() - size
+                buffer.getWritePointer(0, 0),
+                buffer.getReadPointer(0, size),
+                buffer.getNumSamples() - size
             );
 
             juce::FloatVectorOperations::copy(
-                monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-                tempIncomingBuffer.getReadPointer(0, 0),
+                buffer.getWritePointer(0, buffer.getNumSamples() - size),
+                samples + numToSkip,
                 size
             );
+        };
 
-            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
+    auto shiftInBuffer = [this, &shiftIn](const juce::AudioBuffer<float>& incomingBuffer)
+        {
+            auto size = incomingBuffer.getNumSamples();
+            auto* samples = incomingBuffer.getReadPointer(0);
+
+            if (!frontDecimators.empty())
+            {
+                if (frontScratch.size() < (size_t)size)
+                    frontScratch.resize((size_t)size);
+
+                std::copy(samples, samples + size, frontScratch.begin());
+
+                for (auto& decimator : frontDecimators)
+                    size = decimator.process(frontScratch.data(), size, frontScratch.data());
+
+                samples = frontScratch.data();
+            }
+
+            shiftIn(monoBuffer, samples, size);
+            numAnalysedSamples += size;
+
+            //decimate a copy for the low band; each stage runs in place
+            if (lowBandScratch.size() < (size_t)size)
+                lowBandScratch.resize((size_t)size);
+
+            std::copy(samples, samples + size, lowBandScratch.begin());
+
+            for (auto& decimator : lowBandDecimators)
+                size = decimator.process(lowBandScratch.data(), size, lowBandScratch.data());
 
+            if (size > 0)
+            {
+                shiftIn(lowBandBuffer, lowBandScratch.data(), size);
+                numNewLowBandSamples += size;
+            }
+        };
+
+    while (leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
+    {
+        if (leftChannelFifo->readAudioBuffer(shiftInBuffer))
+        {
+            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
         }
     }
+
+    const auto lowBandSampleRate = sampleRate / (double)(1 << lowBandDecimationStages);
+
+    //the low band's window is long, so one new frame per tick is plenty
+    if (numNewLowBandSamples > 0)
+    {
+        lowBandFFTDataGenerator.produceFFTDataForRendering(lowBandBuffer, -48.f);
+        lowBandFrameSeconds = numNewLowBandSamples / lowBandSampleRate;
+        numNewLowBandSamples = 0;
+    }
+
+    while (lowBandFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0)
+    {
+        if (lowBandFFTDataGenerator.getFFTData(lowBandFFTData))
+            lowBandSmoother.process(lowBandFFTData, lowBandFFTDataGenerator.getFFTSize(), lowBandFrameSeconds, -48.f);
+    }
     /*
   if there are FFT data buffers to pull
      if we can pull a buffer
@@ -285,14 +932,40 @@ void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
     const auto fftSize = leftChannelFFTDataGenerator.getFFTSize();
     const auto binWidth = sampleRate / (double) fftSize;
 
+    const auto lowBandBinWidth = lowBandSampleRate / (double)lowBandFFTDataGenerator.getFFTSize();
+    const auto crossoverFrequency = 0.25 * lowBandSampleRate;
+
+    //one frame per buffer from the fifo
+    const auto frameSeconds = leftChannelFifo->getSize() / hostSampleRate;
+
     DBG("RES=" << sampleRate << " " << fftSize << " " << binWidth);
 
+    //one frame per fifo buffer, so the queued frames end that many buffers before the newest sample
+    auto numQueuedFrames = leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks();
+    const auto samplesPerFrame = (double)leftChannelFifo->getSize() * sampleRate / hostSampleRate;
+
     while (leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0)
     {
-        std::vector<float> fftData;
         if (leftChannelFFTDataGenerator.getFFTData(fftData))
         {
-            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f);
+            --numQueuedFrames;
+
+            if (capture != nullptr)
+                capture->pushFrame(fftData, fftSize, sampleRate, (numAnalysedSamples - numQueuedFrames * samplesPerFrame) / sampleRate, -48.f);
+
+            smoother.process(fftData, fftSize, frameSeconds, -48.f);
+
+            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f,
+                                      &lowBandFFTData, (float)lowBandBinWidth, (float)crossoverFrequency);
+
+            if (!smoother.getPeaks().empty())
+                peakPathProducer.generatePath(smoother.getPeaks(), fftBounds, fftSize, binWidth, -48.f,
+                                              &lowBandSmoother.getPeaks(), (float)lowBandBinWidth, (float)crossoverFrequency);
+            else
+                peakHoldPath.clear();
+
+            if (spectrogram != nullptr)
+                spectrogram->addFrame(fftData, fftSize, sampleRate, -48.f);
         }
 
     }
@@ -307,6 +980,11 @@ void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
         pathProducer.getPath(leftChannelFFTPath);
     }
 
+    while (peakPathProducer.getNumPathsAvailable())
+    {
+        peakPathProducer.getPath(peakHoldPath);
+    }
+
 }
 
 
@@ -319,87 +997,40 @@ void ResponseCurveComponent::timerCallback()
 
         leftPathProducer.process(fftBounds, sampleRate);
         rightPathProducer.process(fftBounds, sampleRate);
+        keyPathProducer.process(fftBounds, sampleRate);
     }
 
-    if (parametersChanged.compareAndSetBool(false, true))
+    if (audioProcessor.chainCoefficients.update())
     {
-        updateChain();
-    };
+        updateResponseCurve();
+    }
 
     repaint();
 }
 
-void ResponseCurveComponent::updateChain() 
-{
-    auto chainSettings = getChainSettings(audioProcessor.apvts);
-
-    monoChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypass);
-    monoChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypass);
-    monoChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypass);
-
-    auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCutFilter(monoChain.get<ChainPositions::LowCut>(), lowCutCoefficients, chainSettings.lowCutShape);
-    updateCutFilter(monoChain.get<ChainPositions::HighCut>(), highCutCoefficients, chainSettings.highCutShape);
-
-}
-void ResponseCurveComponent::paint(juce::Graphics& g)
+void ResponseCurveComponent::updateResponseCurve()
 {
     using namespace juce;
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll(Colours::whitesmoke);
-
-    g.drawImage(background, getLocalBounds().toFloat());
 
+    const auto& coefficients = audioProcessor.chainCoefficients.read();
     auto responseArea = getAnalysisArea();
 
-    auto w = responseArea.getWidth();
+    responseCurve.clear();
 
-    auto& lowCut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highCut = monoChain.get<ChainPositions::HighCut>();
-
-    auto sampleRate = audioProcessor.getSampleRate();
+    if (coefficients.sampleRate <= 0 || responseArea.isEmpty())
+        return;
 
+    auto w = responseArea.getWidth();
 
     std::vector<double> mags;
     mags.resize(w);
 
     for (int i = 0; i < w; ++i)
     {
-        double mag = 1.f;
         auto freq = mapToLog10(double(i) / double(w), 20.0, 20000.0);
-        if (!monoChain.isBypassed<ChainPositions::Peak>())
-            mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-        if (!monoChain.isBypassed<ChainPositions::LowCut>()){
-            if (!lowCut.isBypassed<0>())
-                mag *= lowCut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowCut.isBypassed<1>())
-                mag *= lowCut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowCut.isBypassed<2>())
-                mag *= lowCut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowCut.isBypassed<3>())
-                mag *= lowCut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if (!monoChain.isBypassed<ChainPositions::HighCut>()) {
-            if (!highCut.isBypassed<0>())
-                mag *= highCut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highCut.isBypassed<1>())
-                mag *= highCut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highCut.isBypassed<2>())
-                mag *= highCut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highCut.isBypassed<3>())
-                mag *= highCut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        mags[i] = Decibels::gainToDecibels(mag);
+        mags[i] = Decibels::gainToDecibels(coefficients.getMagnitudeForFrequency(freq));
     }
 
-    Path responseCurve;
-
     const double outputMin = responseArea.getBottom();
     const double outputMax = responseArea.getY();
     auto map = [outputMin, outputMax](double input)
@@ -412,9 +1043,53 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
     {
         responseCurve.lineTo(responseArea.getX() + i, map(mags[i]));
     }
-    
-    if (shouldShowFFTAnalysis)
+}
+void ResponseCurveComponent::paint(juce::Graphics& g)
+{
+    using namespace juce;
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll(Colours::whitesmoke);
+
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (background.isNull() || scale != backgroundScale)
+    {
+        background = getGridBackground(scale);
+        backgroundScale = scale;
+    }
+
+    g.drawImage(background, getLocalBounds().toFloat());
+
+    auto responseArea = getAnalysisArea();
+
+    if (shouldShowFFTAnalysis && shouldShowSpectrogram)
+    {
+        spectrogram.draw(g, responseArea);
+    }
+    else if (shouldShowFFTAnalysis)
     {
+        //key spectrum goes underneath the main channels
+        if (audioProcessor.isSidechainConnected())
+        {
+            auto keyFFTPath = keyPathProducer.getPath();
+            keyFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
+
+            g.setColour(Colours::green.withAlpha(0.6f));
+            g.strokePath(keyFFTPath, PathStrokeType(1.f));
+        }
+
+        //held peaks sit faintly above their channels
+        auto leftPeakPath = leftPathProducer.getPeakPath();
+        leftPeakPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
+
+        g.setColour(Colours::blue.withAlpha(0.35f));
+        g.strokePath(leftPeakPath, PathStrokeType(1.f));
+
+        auto rightPeakPath = rightPathProducer.getPeakPath();
+        rightPeakPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
+
+        g.setColour(Colours::orange.withAlpha(0.35f));
+        g.strokePath(rightPeakPath, PathStrokeType(1.f));
+
         auto leftChannelFFTPath = leftPathProducer.getPath();
         leftChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
 
@@ -426,6 +1101,18 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
 
         g.setColour(Colours::orange);
         g.strokePath(rightChannelFFTPath, PathStrokeType(1.f));
+
+        //the audio thread never waits for us, so let the user know when it had to throw analyzer data away.
+        auto numDropped = leftPathProducer.getNumDroppedBuffers() + rightPathProducer.getNumDroppedBuffers();
+        if (numDropped > 0)
+        {
+            String str;
+            str << "dropped " << numDropped;
+
+            g.setColour(Colours::grey);
+            g.setFont(10);
+            g.drawFittedText(str, responseArea.reduced(4), juce::Justification::topLeft, 1);
+        }
     }
 
     g.setColour(Colours::darkgrey);
@@ -438,12 +1125,83 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
 }
 
 
+bool ResponseCurveComponent::startCapture(const juce::File& file)
+{
+    leftPathProducer.setCapture(nullptr);
+
+    if (!capture.start(file, 0))
+        return false;
+
+    leftPathProducer.setCapture(&capture);
+    return true;
+}
+
+void ResponseCurveComponent::stopCapture()
+{
+    leftPathProducer.setCapture(nullptr);
+    capture.stop();
+}
+
+void ResponseCurveComponent::toggleSpectrogram(bool enabled)
+{
+    shouldShowSpectrogram = enabled;
+
+    //the image only exists while the spectrogram is shown
+    if (enabled)
+    {
+        auto area = getAnalysisArea();
+        spectrogram.prepare(area.getWidth(), area.getHeight());
+        leftPathProducer.setSpectrogram(&spectrogram);
+    }
+    else
+    {
+        leftPathProducer.setSpectrogram(nullptr);
+        spectrogram.release();
+    }
+}
+
 void ResponseCurveComponent::resized()
+{
+    updateResponseCurve();
+
+    if (shouldShowSpectrogram)
+    {
+        auto area = getAnalysisArea();
+        spectrogram.prepare(area.getWidth(), area.getHeight());
+    }
+
+    //fetched (or rendered) at the right scale on the next paint
+    background = {};
+}
+
+juce::Image ResponseCurveComponent::getGridBackground(float scale)
 {
     using namespace juce;
-    background = Image(Image::PixelFormat::RGB, getWidth(), getHeight(), true);
 
-    Graphics g(background);
+    //the grid only depends on the component size, so every editor in the process can share it.
+    //ImageCache keeps it alive while any editor uses it and a few seconds after.
+    String key;
+    key << "SimpleEQ grid " << getWidth() << "x" << getHeight() << "@" << scale;
+    auto hashCode = key.hashCode64();
+
+    auto image = ImageCache::getFromHashCode(hashCode);
+    if (image.isValid())
+        return image;
+
+    //render at physical resolution so HiDPI displays don't scale a low-res image at draw time
+    image = Image(Image::PixelFormat::RGB, roundToInt(getWidth() * scale), roundToInt(getHeight() * scale), true);
+
+    Graphics g(image);
+    g.addTransform(AffineTransform::scale(scale));
+    drawBackgroundGrid(g);
+
+    ImageCache::addImageToCache(image, hashCode);
+    return image;
+}
+
+void ResponseCurveComponent::drawBackgroundGrid(juce::Graphics& g)
+{
+    using namespace juce;
     g.setColour(Colours::whitesmoke);
     g.fillAll();
     Array<float> freqs
@@ -574,50 +1332,333 @@ juce::Rectangle<int> ResponseCurveComponent::getAnalysisArea()
     return bounds;
 }
 //==============================================================================
+namespace
+{
+//adds the power of frames [firstFrame, endFrame) of 'reader' into 'powerSums', streaming one hop at a time
+bool accumulateFrames(juce::AudioFormatReader& reader, juce::int64 firstFrame, juce::int64 endFrame, int hopSize,
+                      std::vector<double>& powerSums, const std::atomic<bool>& shouldExit)
+{
+    FFTDataGenerator<std::vector<float>> generator;
+    generator.changeOrder(FFTOrder::order8192);
+
+    const auto fftSize = generator.getFFTSize();
+    const auto numChannels = (int)juce::jmin(2u, reader.numChannels);
+
+    juce::AudioBuffer<float> readBuffer(numChannels, fftSize);
+    juce::AudioBuffer<float> monoBuffer(1, fftSize);
+    std::vector<float> frame;
+
+    //reads 'numSamples' from 'position' and mixes them to mono at the end of monoBuffer
+    auto readMono = [&](juce::int64 position, int numSamples)
+        {
+            if (!reader.read(&readBuffer, 0, numSamples, position, true, numChannels > 1))
+                return false;
+
+            auto* mono = monoBuffer.getWritePointer(0, fftSize - numSamples);
+            juce::FloatVectorOperations::copy(mono, readBuffer.getReadPointer(0), numSamples);
+
+            if (numChannels > 1)
+            {
+                juce::FloatVectorOperations::add(mono, readBuffer.getReadPointer(1), numSamples);
+                juce::FloatVectorOperations::multiply(mono, 0.5f, numSamples);
+            }
+
+            return true;
+        };
+
+    auto position = firstFrame * hopSize;
+    if (!readMono(position, fftSize))
+        return false;
+
+    for (auto frameIndex = firstFrame; frameIndex < endFrame; ++frameIndex)
+    {
+        if ((frameIndex & 63) == 0 && shouldExit.load())
+            return false;
+
+        if (frameIndex > firstFrame)
+        {
+            //slide by one hop and read only the new samples
+            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0), monoBuffer.getReadPointer(0, hopSize), fftSize - hopSize);
+            position += hopSize;
+
+            if (!readMono(position + fftSize - hopSize, hopSize))
+                return false;
+        }
+
+        //the generator hands back normalised dB; averaging has to happen on power
+        generator.produceFFTDataForRendering(monoBuffer, -200.f);
+
+        if (generator.getFFTData(frame))
+            for (size_t bin = 0; bin < powerSums.size(); ++bin)
+                powerSums[bin] += std::pow(10.0, frame[bin] * 0.1);
+    }
+
+    return true;
+}
+
+//power spectrum interpolated onto 'frequencies' and smoothed over +/- 'halfWidth' grid points, in dB
+std::vector<float> toGridDecibels(const SpectrumMatcher::AverageSpectrum& spectrum, const std::vector<double>& frequencies, int halfWidth)
+{
+    const auto binWidth = spectrum.sampleRate / spectrum.fftSize;
+    const auto lastBin = (int)spectrum.power.size() - 1;
+
+    std::vector<double> power(frequencies.size());
+    for (size_t i = 0; i < frequencies.size(); ++i)
+    {
+        const auto position = juce::jlimit(0.0, (double)lastBin, frequencies[i] / binWidth);
+        const auto bin = juce::jmin((int)position, lastBin - 1);
+        const auto fraction = position - bin;
+
+        power[i] = spectrum.power[(size_t)bin] * (1.0 - fraction) + spectrum.power[(size_t)bin + 1] * fraction;
+    }
+
+    std::vector<float> decibels(frequencies.size());
+    for (int i = 0; i < (int)frequencies.size(); ++i)
+    {
+        const auto first = juce::jmax(0, i - halfWidth), last = juce::jmin((int)frequencies.size() - 1, i + halfWidth);
+        const auto mean = std::accumulate(power.begin() + first, power.begin() + last + 1, 0.0) / (last - first + 1);
+
+        decibels[(size_t)i] = (float)(10.0 * std::log10(juce::jmax(mean, 1.0e-20)));
+    }
+
+    return decibels;
+}
+}
+
+bool SpectrumMatcher::computeAverageSpectrum(const juce::File& file, AverageSpectrum& result, const std::atomic<bool>& shouldExit)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    const auto fftSize = 1 << FFTOrder::order8192;
+    const auto hopSize = fftSize / 2;
+
+    //readers aren't thread safe, so every job gets its own
+    std::vector<std::unique_ptr<juce::AudioFormatReader>> readers;
+    readers.emplace_back(formatManager.createReaderFor(file));
+
+    if (readers.front() == nullptr || readers.front()->lengthInSamples < fftSize)
+        return false;
+
+    const auto numFrames = (readers.front()->lengthInSamples - fftSize) / hopSize + 1;
+    const auto numJobs = (int)juce::jlimit<juce::int64>(1, juce::jmax(1, juce::SystemStats::getNumCpus()), numFrames);
+
+    while ((int)readers.size() < numJobs)
+    {
+        readers.emplace_back(formatManager.createReaderFor(file));
+        if (readers.back() == nullptr)
+            return false;
+    }
+
+    std::vector<std::vector<double>> powerSums((size_t)numJobs, std::vector<double>((size_t)fftSize / 2, 0.0));
+    std::atomic<int> numRemaining{ numJobs };
+    std::atomic<bool> failed{ false };
+    juce::WaitableEvent finished;
+
+    {
+        juce::ThreadPool pool(numJobs);
+
+        for (int job = 0; job < numJobs; ++job)
+        {
+            const auto firstFrame = numFrames * job / numJobs;
+            const auto endFrame = numFrames * (job + 1) / numJobs;
+
+            pool.addJob([&, job, firstFrame, endFrame]
+                {
+                    if (!accumulateFrames(*readers[(size_t)job], firstFrame, endFrame, hopSize, powerSums[(size_t)job], shouldExit))
+                        failed.store(true);
+
+                    if (--numRemaining == 0)
+                        finished.signal();
+                });
+        }
+
+        finished.wait();
+    }
+
+    if (failed.load())
+        return false;
+
+    result.power.assign((size_t)fftSize / 2, 0.0);
+    for (const auto& sums : powerSums)
+        for (size_t bin = 0; bin < sums.size(); ++bin)
+            result.power[bin] += sums[bin] / (double)numFrames;
+
+    result.sampleRate = readers.front()->sampleRate;
+    result.fftSize = fftSize;
+    return true;
+}
+
+ChainSettings SpectrumMatcher::match(const AverageSpectrum& reference, const AverageSpectrum& target)
+{
+    //1/12 octave grid over the displayed range (or as far as both files reach), compared at 1/3 octave resolution
+    constexpr int pointsPerOctave = 12;
+    const auto maxFrequency = juce::jmin(20000.0, 0.45 * reference.sampleRate, 0.45 * target.sampleRate);
+
+    std::vector<double> frequencies;
+    for (auto f = 20.0; f <= maxFrequency; f *= std::pow(2.0, 1.0 / pointsPerOctave))
+        frequencies.push_back(f);
+
+    const auto referenceDecibels = toGridDecibels(reference, frequencies, pointsPerOctave / 6);
+    const auto targetDecibels = toGridDecibels(target, frequencies, pointsPerOctave / 6);
+
+    std::vector<float> wanted(frequencies.size());
+    for (size_t i = 0; i < wanted.size(); ++i)
+        wanted[i] = referenceDecibels[i] - targetDecibels[i];
+
+    ResponseFitter fitter(frequencies, target.sampleRate);
+    return fitter.fit(wanted);
+}
+
+SpectrumMatchThread::SpectrumMatchThread(const juce::File& reference, const juce::File& target, Callback callback) :
+juce::Thread("SimpleEQ spectrum match"),
+referenceFile(reference),
+targetFile(target),
+onFinished(std::move(callback))
+{
+}
+
+SpectrumMatchThread::~SpectrumMatchThread()
+{
+    shouldExit.store(true);
+    stopThread(10000);
+}
+
+void SpectrumMatchThread::run()
+{
+    SpectrumMatcher::AverageSpectrum reference, target;
+    ChainSettings settings;
+
+    const auto succeeded = SpectrumMatcher::computeAverageSpectrum(referenceFile, reference, shouldExit)
+                        && SpectrumMatcher::computeAverageSpectrum(targetFile, target, shouldExit);
+
+    if (succeeded)
+        settings = SpectrumMatcher::match(reference, target);
+
+    if (!shouldExit.load())
+        juce::MessageManager::callAsync([callback = onFinished, succeeded, settings] { callback(succeeded, settings); });
+}
+//==============================================================================
+LevelMeterComponent::LevelMeterComponent(SimpleEQAudioProcessor& p) : audioProcessor(p)
+{
+    startTimerHz(30);
+}
+
+LevelMeterComponent::~LevelMeterComponent()
+{
+    stopTimer();
+    audioProcessor.setMeteringEnabled(false);
+}
+
+void LevelMeterComponent::setMeteringEnabled(bool enabled)
+{
+    isMetering = enabled;
+    audioProcessor.setMeteringEnabled(enabled);
+    repaint();
+}
+
+void LevelMeterComponent::timerCallback()
+{
+    if (isMetering && audioProcessor.meterSnapshots.update())
+        repaint();
+}
+
+void LevelMeterComponent::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().reduced(2);
+
+    if (!isMetering)
+    {
+        g.setColour(juce::Colours::grey);
+        g.setFont(10);
+        g.drawFittedText("meters off", bounds, juce::Justification::centred, 2);
+        return;
+    }
+
+    const auto& snapshot = audioProcessor.meterSnapshots.read();
+
+    drawMeter(g, bounds.removeFromLeft(bounds.getWidth() / 2).reduced(1, 0), snapshot.input, "IN");
+    drawMeter(g, bounds.reduced(1, 0), snapshot.output, "OUT");
+}
+
+void LevelMeterComponent::drawMeter(juce::Graphics& g, juce::Rectangle<int> area, const MeterReadings& readings, const juce::String& title)
+{
+    using namespace juce;
+
+    const int lineHeight = 10;
+    g.setFont(9);
+
+    g.setColour(Colours::black);
+    g.drawFittedText(title, area.removeFromTop(lineHeight), Justification::centred, 1);
+
+    auto formatLevel = [](float level)
+        {
+            return level <= MeterReadings::floor ? String("-inf") : String(level, 1);
+        };
+
+    auto textArea = area.removeFromBottom(3 * lineHeight);
+    const auto truePeak = jmax(readings.truePeak[0], readings.truePeak[1]);
+
+    g.setColour(truePeak > 0.f ? Colours::red : Colours::black);
+    g.drawFittedText("TP " + formatLevel(truePeak), textArea.removeFromTop(lineHeight), Justification::centred, 1);
+    g.setColour(Colours::black);
+    g.drawFittedText("M " + formatLevel(readings.momentaryLoudness), textArea.removeFromTop(lineHeight), Justification::centred, 1);
+    g.drawFittedText("S " + formatLevel(readings.shortTermLoudness), textArea.removeFromTop(lineHeight), Justification::centred, 1);
+
+    //bars show -60..0 dBFS: RMS filled, peak as a line
+    auto mapLevel = [&area](float level)
+        {
+            return jmap(jlimit(-60.f, 0.f, level), -60.f, 0.f, (float)area.getBottom(), (float)area.getY());
+        };
+
+    auto barArea = area.reduced(2, 2);
+    const auto barWidth = barArea.getWidth() / 2;
+
+    for (size_t ch = 0; ch < 2; ++ch)
+    {
+        auto bar = barArea.removeFromLeft(barWidth).reduced(1, 0).toFloat();
+
+        g.setColour(Colours::lightgrey);
+        g.fillRect(bar);
+
+        g.setColour(Colours::green);
+        g.fillRect(bar.withTop(mapLevel(readings.rms[ch])));
+
+        g.setColour(readings.peak[ch] >= 0.f ? Colours::red : Colours::darkgreen);
+        g.fillRect(bar.withTop(mapLevel(readings.peak[ch])).withHeight(2.f));
+    }
+}
+//==============================================================================
 SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcessor& p)
     : AudioProcessorEditor(&p), audioProcessor(p),
-    peakFreqSlider(*audioProcessor.apvts.getParameter("Peak Freq"), "Hz"),
-    peakGainSlider(*audioProcessor.apvts.getParameter("Peak Gain"), "dB"),
-    peakQSlider(*audioProcessor.apvts.getParameter("Peak Q"), ""),
-    lowCutFreqSlider(*audioProcessor.apvts.getParameter("LowCut Freq"), "Hz"),
-    lowCutShapeSlider(*audioProcessor.apvts.getParameter("LowCut Shape"), "dB/Oct"),
-    highCutFreqSlider(*audioProcessor.apvts.getParameter("HighCut Freq"), "Hz"),
-    highCutShapeSlider(*audioProcessor.apvts.getParameter("HighCut Shape"), "dB/Oct"),
-
+    constructionTicks(juce::Time::getHighResolutionTicks()),
     responseCurveComponent(audioProcessor),
-    peakFreqSliderAttachment(audioProcessor.apvts, "Peak Freq", peakFreqSlider),
-    peakGainSliderAttachment(audioProcessor.apvts, "Peak Gain", peakGainSlider),
-    peakQSliderAttachment(audioProcessor.apvts, "Peak Q", peakQSlider),
-    lowCutFreqSliderAttachment(audioProcessor.apvts, "LowCut Freq", lowCutFreqSlider),
-    lowCutShapeSliderAttachment(audioProcessor.apvts, "LowCut Shape", lowCutShapeSlider),
-    highCutFreqSliderAttachment(audioProcessor.apvts, "HighCut Freq", highCutFreqSlider),
-    highCutShapeSliderAttachment(audioProcessor.apvts, "HighCut Shape", highCutShapeSlider),
-
-    lowCutBypassAttachment(audioProcessor.apvts, "LowCut Bypass", lowCutBypassButton),
-    highCutBypassAttachment(audioProcessor.apvts, "HighCut Bypass", highCutBypassButton),
-    peakBypassAttachment(audioProcessor.apvts, "Peak Bypass", peakBypassButton),
-    analyzerEnableAttachment(audioProcessor.apvts, "Analyzer Enable", analyzerEnableButton)
+    levelMeters(audioProcessor)
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
 
-    peakFreqSlider.labels.add({ 0.f, "20Hz" });
-    peakFreqSlider.labels.add({ 1.f, "20kHz" });
-    lowCutFreqSlider.labels.add({ 0.f, "20Hz" });
-    lowCutFreqSlider.labels.add({ 1.f, "20kHz" });
-    highCutFreqSlider.labels.add({ 0.f, "20Hz" });
-    highCutFreqSlider.labels.add({ 1.f, "20kHz" });
+    createAttachments();
 
-    peakQSlider.labels.add({ 0.f, "0.1" });
-    peakQSlider.labels.add({ 1.f, "10" });
-    peakGainSlider.labels.add({ 0.f, "-24dB" });
-    peakGainSlider.labels.add({ 1.f, "+24dB" });
+    getSlider(Parameters::PeakFreq).labels.add({ 0.f, "20Hz" });
+    getSlider(Parameters::PeakFreq).labels.add({ 1.f, "20kHz" });
+    getSlider(Parameters::LowCutFreq).labels.add({ 0.f, "20Hz" });
+    getSlider(Parameters::LowCutFreq).labels.add({ 1.f, "20kHz" });
+    getSlider(Parameters::HighCutFreq).labels.add({ 0.f, "20Hz" });
+    getSlider(Parameters::HighCutFreq).labels.add({ 1.f, "20kHz" });
 
-    lowCutShapeSlider.labels.add({ 0.f, "12" });
-    lowCutShapeSlider.labels.add({ 1.f, "48" });
-    highCutShapeSlider.labels.add({ 0.f, "12" });
-    highCutShapeSlider.labels.add({ 1.f, "48" });
+    getSlider(Parameters::PeakQ).labels.add({ 0.f, "0.1" });
+    getSlider(Parameters::PeakQ).labels.add({ 1.f, "10" });
+    getSlider(Parameters::PeakGain).labels.add({ 0.f, "-24dB" });
+    getSlider(Parameters::PeakGain).labels.add({ 1.f, "+24dB" });
 
+    getSlider(Parameters::LowCutShape).labels.add({ 0.f, "12" });
+    getSlider(Parameters::LowCutShape).labels.add({ 1.f, "48" });
+    getSlider(Parameters::HighCutShape).labels.add({ 0.f, "12" });
+    getSlider(Parameters::HighCutShape).labels.add({ 1.f, "48" });
+
+    analyzerSmoothingBox.addItemList({ "Raw", "1/3 Oct", "1/6 Oct", "1/12 Oct", "1/24 Oct" }, 1);
+    analyzerSmoothingBox.setSelectedId(1, juce::dontSendNotification);
 
     for (auto* comp : getComps())
     {
@@ -628,6 +1669,7 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcesso
     highCutBypassButton.setLookAndFeel(&lnf);
     peakBypassButton.setLookAndFeel(&lnf);
     analyzerEnableButton.setLookAndFeel(&lnf);
+    spectrogramButton.setLookAndFeel(&lnf);
 
     auto safePtr = juce::Component::SafePointer<SimpleEQAudioProcessorEditor>(this);
     peakBypassButton.onClick = [safePtr]()
@@ -635,9 +1677,9 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcesso
         if (auto* comp = safePtr.getComponent())
         {
             auto bypassed = comp->peakBypassButton.getToggleState();
-            comp->peakFreqSlider.setEnabled(!bypassed);
-            comp->peakGainSlider.setEnabled(!bypassed);
-            comp->peakQSlider.setEnabled(!bypassed);
+            comp->getSlider(Parameters::PeakFreq).setEnabled(!bypassed);
+            comp->getSlider(Parameters::PeakGain).setEnabled(!bypassed);
+            comp->getSlider(Parameters::PeakQ).setEnabled(!bypassed);
         }
     };
 
@@ -646,8 +1688,9 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcesso
         if (auto* comp = safePtr.getComponent())
         {
             auto bypassed = comp->lowCutBypassButton.getToggleState();
-            comp->lowCutFreqSlider.setEnabled(!bypassed);
-            comp->lowCutShapeSlider.setEnabled(!bypassed);
+            comp->getSlider(Parameters::LowCutFreq).setEnabled(!bypassed);
+            comp->getSlider(Parameters::LowCutShape).setEnabled(!bypassed);
+            comp->lowCutExtendedSlopeBox.setEnabled(!bypassed);
         }
     };
     highCutBypassButton.onClick = [safePtr]()
@@ -655,8 +1698,9 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcesso
         if (auto* comp = safePtr.getComponent())
         {
             auto bypassed = comp->highCutBypassButton.getToggleState();
-            comp->highCutFreqSlider.setEnabled(!bypassed);
-            comp->highCutShapeSlider.setEnabled(!bypassed);
+            comp->getSlider(Parameters::HighCutFreq).setEnabled(!bypassed);
+            comp->getSlider(Parameters::HighCutShape).setEnabled(!bypassed);
+            comp->highCutExtendedSlopeBox.setEnabled(!bypassed);
         }
     };
 
@@ -669,6 +1713,63 @@ SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor(SimpleEQAudioProcesso
         }
     };
 
+    spectrogramButton.onClick = [safePtr]()
+    {
+        if (auto* comp = safePtr.getComponent())
+        {
+            auto enabled = comp->spectrogramButton.getToggleState();
+            comp->responseCurveComponent.toggleSpectrogram(enabled);
+        }
+    };
+
+    captureButton.onClick = [safePtr]()
+    {
+        if (auto* comp = safePtr.getComponent())
+        {
+            auto& curve = comp->responseCurveComponent;
+
+            if (!comp->captureButton.getToggleState())
+            {
+                curve.stopCapture();
+                return;
+            }
+
+            auto file = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                            .getChildFile("SimpleEQ Captures")
+                            .getChildFile("capture " + juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S") + ".seqc");
+
+            if (file.getParentDirectory().createDirectory().failed() || !curve.startCapture(file))
+                comp->captureButton.setToggleState(false, juce::dontSendNotification);
+        }
+    };
+
+    matchButton.onClick = [safePtr]()
+    {
+        if (auto* comp = safePtr.getComponent())
+            comp->chooseMatchFiles();
+    };
+
+    meteringButton.setToggleState(true, juce::dontSendNotification);
+    levelMeters.setMeteringEnabled(true);
+
+    meteringButton.onClick = [safePtr]()
+    {
+        if (auto* comp = safePtr.getComponent())
+            comp->levelMeters.setMeteringEnabled(comp->meteringButton.getToggleState());
+    };
+
+    analyzerSmoothingBox.onChange = [safePtr]()
+    {
+        if (auto* comp = safePtr.getComponent())
+            comp->updateAnalyzerSmoothing();
+    };
+
+    peakHoldButton.onClick = [safePtr]()
+    {
+        if (auto* comp = safePtr.getComponent())
+            comp->updateAnalyzerSmoothing();
+    };
+
     setSize(600, 500);
 }
 
@@ -678,6 +1779,111 @@ SimpleEQAudioProcessorEditor::~SimpleEQAudioProcessorEditor()
     highCutBypassButton.setLookAndFeel(nullptr);
     peakBypassButton.setLookAndFeel(nullptr);
     analyzerEnableButton.setLookAndFeel(nullptr);
+    spectrogramButton.setLookAndFeel(nullptr);
+}
+
+void SimpleEQAudioProcessorEditor::chooseMatchFiles()
+{
+    const auto patterns = juce::String("*.wav;*.aif;*.aiff;*.flac");
+    auto safePtr = juce::Component::SafePointer<SimpleEQAudioProcessorEditor>(this);
+
+    //two choosers, since one can't be replaced from inside its own callback
+    referenceChooser = std::make_unique<juce::FileChooser>("Choose the reference (the sound to match)", juce::File(), patterns);
+    referenceChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+        [safePtr, patterns](const juce::FileChooser& chooser)
+        {
+            auto* comp = safePtr.getComponent();
+            auto reference = chooser.getResult();
+
+            if (comp == nullptr || reference == juce::File())
+                return;
+
+            comp->targetChooser = std::make_unique<juce::FileChooser>("Choose the file to EQ", reference.getParentDirectory(), patterns);
+            comp->targetChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                [safePtr, reference](const juce::FileChooser& targetChooser)
+                {
+                    auto target = targetChooser.getResult();
+
+                    if (auto* editor = safePtr.getComponent(); editor != nullptr && target != juce::File())
+                        editor->startMatch(reference, target);
+                });
+        });
+}
+
+void SimpleEQAudioProcessorEditor::startMatch(const juce::File& reference, const juce::File& target)
+{
+    auto safePtr = juce::Component::SafePointer<SimpleEQAudioProcessorEditor>(this);
+
+    matchButton.setEnabled(false);
+    matchButton.setButtonText("Matching...");
+
+    matchThread = std::make_unique<SpectrumMatchThread>(reference, target,
+        [safePtr, target](bool succeeded, const ChainSettings& settings)
+        {
+            if (auto* comp = safePtr.getComponent())
+            {
+                comp->matchThread.reset();
+                comp->matchButton.setEnabled(true);
+                comp->matchButton.setButtonText(succeeded ? "Match EQ..." : "Match failed");
+
+                if (succeeded)
+                    comp->applyMatch(settings, target);
+            }
+        });
+
+    matchThread->startThread();
+}
+
+/*
+ The fitted settings go onto the parameters (so the host sees and saves them), and the resulting state is
+ also written next to the target file in the getStateInformation() format.
+ */
+void SimpleEQAudioProcessorEditor::applyMatch(const ChainSettings& settings, const juce::File& target)
+{
+    auto setParameter = [this](Parameters::ID id, float value)
+        {
+            if (auto* param = audioProcessor.apvts.getParameter(Parameters::getID(id)))
+            {
+                param->beginChangeGesture();
+                param->setValueNotifyingHost(param->convertTo0to1(value));
+                param->endChangeGesture();
+            }
+        };
+
+    setParameter(Parameters::LowCutFreq, settings.lowCutFreq);
+    setParameter(Parameters::LowCutShape, (float)getSlopeChoice(settings.lowCutShape));
+    setParameter(Parameters::LowCutExtendedSlope, (float)getExtendedSlopeChoice(settings.lowCutShape));
+    setParameter(Parameters::LowCutType, (float)settings.lowCutFamily);
+    setParameter(Parameters::LowCutBypass, settings.lowCutBypass ? 1.f : 0.f);
+
+    setParameter(Parameters::HighCutFreq, settings.highCutFreq);
+    setParameter(Parameters::HighCutShape, (float)getSlopeChoice(settings.highCutShape));
+    setParameter(Parameters::HighCutExtendedSlope, (float)getExtendedSlopeChoice(settings.highCutShape));
+    setParameter(Parameters::HighCutType, (float)settings.highCutFamily);
+    setParameter(Parameters::HighCutBypass, settings.highCutBypass ? 1.f : 0.f);
+
+    setParameter(Parameters::PeakFreq, settings.peakFreq);
+    setParameter(Parameters::PeakGain, settings.peakGainInDecibels);
+    setParameter(Parameters::PeakQ, settings.peakQ);
+    setParameter(Parameters::PeakBypass, 0.f);
+
+    juce::MemoryBlock state;
+    audioProcessor.getStateInformation(state);
+    target.getSiblingFile(target.getFileNameWithoutExtension() + " match.simpleeq").replaceWithData(state.getData(), state.getSize());
+}
+
+void SimpleEQAudioProcessorEditor::updateAnalyzerSmoothing()
+{
+    SpectrumSmoother::Settings settings;
+
+    //item ids follow the OctaveSmoothing order, starting at 1
+    settings.smoothing = static_cast<OctaveSmoothing>(juce::jmax(0, analyzerSmoothingBox.getSelectedId() - 1));
+
+    //a smoothed display is also averaged over time, which is what makes it readable
+    settings.averagingTimeMs = settings.smoothing == OctaveSmoothing::None ? 0.f : 150.f;
+    settings.peakHold = peakHoldButton.getToggleState();
+
+    responseCurveComponent.setAnalyzerSmoothing(settings);
 }
 
 //==============================================================================
@@ -688,6 +1894,15 @@ void SimpleEQAudioProcessorEditor::paint(juce::Graphics& g)
     g.fillAll(Colours::whitesmoke);
 }
 
+void SimpleEQAudioProcessorEditor::paintOverChildren(juce::Graphics&)
+{
+    using namespace juce;
+
+    //children (including the response curve) have been painted by now; read through getTimeToFirstPaintMs()
+    if (timeToFirstPaintMs < 0)
+        timeToFirstPaintMs = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - constructionTicks) * 1000.0;
+}
+
 void SimpleEQAudioProcessorEditor::resized()
 {
 
@@ -699,12 +1914,22 @@ void SimpleEQAudioProcessorEditor::resized()
     analyzerEnableArea.removeFromTop(2);
 
     analyzerEnableButton.setBounds(analyzerEnableArea);
+    spectrogramButton.setBounds(analyzerEnableArea.translated(analyzerEnableArea.getWidth() + 5, 0));
+    analyzerSmoothingBox.setBounds(analyzerEnableArea.translated(2 * (analyzerEnableArea.getWidth() + 5), 0));
+    peakHoldButton.setBounds(analyzerEnableArea.translated(3 * (analyzerEnableArea.getWidth() + 5), 0).withWidth(90));
+    meteringButton.setBounds(peakHoldButton.getBounds().translated(92, 0).withWidth(60));
+    stereoModeBox.setBounds(analyzerEnableArea.withX(getWidth() - 125).withWidth(120));
 
     bounds.removeFromTop(5);
 
     float hRatio = 30.f / 100.f;
     auto responseArea = bounds.removeFromTop(bounds.getHeight() * hRatio);
 
+    auto meterArea = responseArea.removeFromRight(80);
+    matchButton.setBounds(meterArea.removeFromBottom(20).reduced(2, 1));
+    captureButton.setBounds(meterArea.removeFromBottom(20));
+    autoGainButton.setBounds(meterArea.removeFromBottom(20));
+    levelMeters.setBounds(meterArea);
     responseCurveComponent.setBounds(responseArea);
 
     bounds.removeFromTop(10);
@@ -713,35 +1938,111 @@ void SimpleEQAudioProcessorEditor::resized()
 
 
     lowCutBypassButton.setBounds(lowCutArea.removeFromTop(25));
-    lowCutFreqSlider.setBounds(lowCutArea.removeFromTop(lowCutArea.getHeight() * 0.5));
-    lowCutShapeSlider.setBounds(lowCutArea);
+    getSlider(Parameters::LowCutFreq).setBounds(lowCutArea.removeFromTop(lowCutArea.getHeight() * 0.5));
+    lowCutExtendedSlopeBox.setBounds(lowCutArea.removeFromBottom(22).reduced(20, 0));
+    getSlider(Parameters::LowCutShape).setBounds(lowCutArea);
 
     highCutBypassButton.setBounds(highCutArea.removeFromTop(25));
-    highCutFreqSlider.setBounds(highCutArea.removeFromTop(highCutArea.getHeight() * 0.5));
-    highCutShapeSlider.setBounds(highCutArea);
+    getSlider(Parameters::HighCutFreq).setBounds(highCutArea.removeFromTop(highCutArea.getHeight() * 0.5));
+    highCutExtendedSlopeBox.setBounds(highCutArea.removeFromBottom(22).reduced(20, 0));
+    getSlider(Parameters::HighCutShape).setBounds(highCutArea);
 
     peakBypassButton.setBounds(bounds.removeFromTop(25));
-    peakFreqSlider.setBounds(bounds.removeFromTop(bounds.getHeight() * 0.33));
-    peakGainSlider.setBounds(bounds.removeFromTop(bounds.getHeight() * 0.5));
-    peakQSlider.setBounds(bounds);
+    getSlider(Parameters::PeakFreq).setBounds(bounds.removeFromTop(bounds.getHeight() * 0.33));
+    getSlider(Parameters::PeakGain).setBounds(bounds.removeFromTop(bounds.getHeight() * 0.5));
+    getSlider(Parameters::PeakQ).setBounds(bounds);
 }
  
 std::vector<juce::Component*> SimpleEQAudioProcessorEditor::getComps()
 {
-    return
+    std::vector<juce::Component*> comps
     {
-        &peakFreqSlider,
-        &peakGainSlider,
-        &peakQSlider,
-        &lowCutFreqSlider,
-        &highCutFreqSlider,
-        &lowCutShapeSlider,
-        &highCutShapeSlider,
         &responseCurveComponent,
+        &levelMeters,
+        &autoGainButton,
+        &matchButton,
+        &captureButton,
 
         &lowCutBypassButton, 
         &highCutBypassButton, 
         &peakBypassButton, 
-        &analyzerEnableButton
+        &analyzerEnableButton,
+        &spectrogramButton,
+        &analyzerSmoothingBox,
+        &peakHoldButton,
+        &meteringButton,
+        &stereoModeBox,
+        &lowCutExtendedSlopeBox,
+        &highCutExtendedSlopeBox
     };
-}
\ No newline at end of file
+
+    for (auto& slider : sliders)
+        if (slider != nullptr)
+            comps.push_back(slider.get());
+
+    return comps;
+}
+
+void SimpleEQAudioProcessorEditor::createAttachments()
+{
+    auto& apvts = audioProcessor.apvts;
+
+    for (size_t i = 0; i < Parameters::table.size(); ++i)
+    {
+        const auto id = static_cast<Parameters::ID>(i);
+
+        switch (Parameters::table[i].control)
+        {
+            case Parameters::Control::Rotary:
+                sliders[i] = std::make_unique<RotarySliderWithLabels>(apvts, id);
+                sliderAttachments.push_back(std::make_unique<Attachment>(apvts, Parameters::getID(id), *sliders[i]));
+                break;
+            case Parameters::Control::Button:
+                buttonAttachments.push_back(std::make_unique<ButtonAttachment>(apvts, Parameters::getID(id), getButton(id)));
+                break;
+            case Parameters::Control::ComboBox:
+            {
+                //the box has to be filled before its attachment is created
+                auto& box = getComboBox(id);
+                if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter(Parameters::getID(id))))
+                    box.addItemList(choice->choices, 1);
+
+                comboBoxAttachments.push_back(std::make_unique<APVTS::ComboBoxAttachment>(apvts, Parameters::getID(id), box));
+                break;
+            }
+            case Parameters::Control::None:
+                break;
+        }
+    }
+}
+
+//the buttons and boxes differ in look and placement, so which control shows which parameter stays here
+juce::Button& SimpleEQAudioProcessorEditor::getButton(Parameters::ID id)
+{
+    switch (id)
+    {
+        case Parameters::LowCutBypass: return lowCutBypassButton;
+        case Parameters::HighCutBypass: return highCutBypassButton;
+        case Parameters::PeakBypass: return peakBypassButton;
+        case Parameters::AnalyzerEnable: return analyzerEnableButton;
+        case Parameters::AutoGain: return autoGainButton;
+        default: break;
+    }
+
+    jassertfalse;   //flagged Control::Button in the table but given no button here
+    return autoGainButton;
+}
+
+juce::ComboBox& SimpleEQAudioProcessorEditor::getComboBox(Parameters::ID id)
+{
+    switch (id)
+    {
+        case Parameters::StereoMode: return stereoModeBox;
+        case Parameters::LowCutExtendedSlope: return lowCutExtendedSlopeBox;
+        case Parameters::HighCutExtendedSlope: return highCutExtendedSlopeBox;
+        default: break;
+    }
+
+    jassertfalse;   //flagged Control::ComboBox in the table but given no box here
+    return stereoModeBox;
+}
@@ -18,6 +18,34 @@ enum FFTOrder
     order8192 = 13
 };
 
+/*
+ Halves the sample rate with a linear-phase half-band FIR. Every other tap of a half-band
+ filter is zero and only every second output is computed, so each input sample costs
+ about numSideTaps multiplies. With the default 8 the passband is flat to ~0.16 of the
+ input rate; 20 keeps it flat to ~0.21 (20kHz at 96kHz) with the alias band 75dB down.
+ */
+struct HalfBandDecimator
+{
+    explicit HalfBandDecimator(int numSideTaps = 8);
+
+    void reset();
+
+    /**
+     consumes 'numSamples' input samples and writes the decimated ones to 'output', which may alias 'input'.
+     returns how many were written (numSamples / 2, give or take one depending on the phase).
+     */
+    int process(const float* input, int numSamples, float* output);
+private:
+    int numSideTaps;    //nonzero taps either side of the centre
+    int length;         //4 * numSideTaps - 1 taps
+    int centre;
+
+    std::vector<float> coefficients;    //taps at centre +/- 1, 3, 5...
+    std::vector<float> history;         //written twice so a window is always contiguous
+    int writeIndex = 0;
+    bool isOddSample = false;
+};
+
 template<typename BlockType>
 struct FFTDataGenerator
 {
@@ -26,9 +54,16 @@ struct FFTDataGenerator
      */
     void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
     {
+        //render straight into the fifo slot; if the consumer has fallen behind, skip the frame entirely.
+        auto* slot = fftDataFifo.acquireWrite();
+        if (slot == nullptr)
+            return;
+
+        auto& fftData = *slot;
         const auto fftSize = getFFTSize();
 
-        fftData.assign(fftData.size(), 0);
+        fftData.resize((size_t)fftSize * 2);
+        std::fill(fftData.begin(), fftData.end(), 0.f);
         auto* readIndex = audioData.getReadPointer(0);
         std::copy(readIndex, readIndex + fftSize, fftData.begin());
 
@@ -52,7 +87,7 @@ struct FFTDataGenerator
             fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
         }
 
-        fftDataFifo.push(fftData);
+        fftDataFifo.commitWrite();
     }
 
     void changeOrder(FFTOrder newOrder)
@@ -67,19 +102,21 @@ struct FFTDataGenerator
         forwardFFT = std::make_unique<juce::dsp::FFT>(order);
         window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
 
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
-
-        fftDataFifo.prepare(fftData.size());
+        fftDataFifo.prepare((size_t)fftSize * 2);
     }
     //==============================================================================
     int getFFTSize() const { return 1 << order; }
     int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); }
     //==============================================================================
     bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); }
+
+    size_t getMemoryUsage() const
+    {
+        //the window table holds one float per sample; the FFT's own tables are roughly twice that
+        return fftDataFifo.getMemoryUsage() + 3 * sizeof(float) * (size_t)getFFTSize();
+    }
 private:
     FFTOrder order;
-    BlockType fftData;
     std::unique_ptr<juce::dsp::FFT> forwardFFT;
     std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
 
@@ -90,13 +127,18 @@ template<typename PathType>
 struct AnalyzerPathGenerator
 {
     /*
-     converts 'renderData[]' into a juce::Path
+     converts 'renderData[]' into a juce::Path.
+     if 'lowBandData' is given it is a finer spectrum of the lows (a longer FFT of a decimated signal) and
+     is drawn up to 'crossoverFrequency', with 'renderData' taking over from there.
      */
     void generatePath(const std::vector<float>& renderData,
         juce::Rectangle<float> fftBounds,
         int fftSize,
         float binWidth,
-        float negativeInfinity)
+        float negativeInfinity,
+        const std::vector<float>* lowBandData = nullptr,
+        float lowBandBinWidth = 0.f,
+        float crossoverFrequency = 0.f)
     {
         auto top = fftBounds.getY();
         auto bottom = fftBounds.getHeight();
@@ -104,7 +146,13 @@ struct AnalyzerPathGenerator
 
         int numBins = (int)fftSize / 2;
 
-        PathType p;
+        //build the path in place; if the fifo is full the frame is skipped.
+        auto* slot = pathFifo.acquireWrite();
+        if (slot == nullptr)
+            return;
+
+        PathType& p = *slot;
+        p.clear();
         p.preallocateSpace(3 * (int)fftBounds.getWidth());
 
         auto map = [bottom, top, negativeInfinity](float v)
@@ -114,30 +162,58 @@ struct AnalyzerPathGenerator
                     float(bottom), top);
             };
 
-        auto y = map(renderData[0]);
+        auto addBins = [&p, &map, width](const std::vector<float>& data, float bandBinWidth, int firstBin, int endBin, int step)
+            {
+                for (int binNum = firstBin; binNum < endBin; binNum += step)
+                {
+                    auto y = map(data[(size_t)binNum]);
+
+                    jassert(!std::isnan(y) && !std::isinf(y));
+
+                    if (!std::isnan(y) && !std::isinf(y))
+                    {
+                        auto binFreq = binNum * bandBinWidth;
+                        auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
+                        int binX = std::floor(normalizedBinX * width);
+                        p.lineTo(binX, y);
+                    }
+                }
+            };
+
+        const int pathResolution = 2; //you can draw line-to's every 'pathResolution' pixels.
 
-        jassert(!std::isnan(y) && !std::isinf(y));
+        const auto hasLowBand = lowBandData != nullptr && !lowBandData->empty()
+                             && lowBandBinWidth > 0.f && crossoverFrequency > binWidth;
 
-        p.startNewSubPath(0, y);
+        if (hasLowBand)
+        {
+            //the low band is sparse on the log axis, so every bin gets a point. it starts at the last bin below 20Hz.
+            const auto& lows = *lowBandData;
+            const auto numLowBins = (int)lows.size() / 2;
+            const auto firstLowBin = juce::jlimit(1, numLowBins - 1, (int)(20.f / lowBandBinWidth));
+            const auto endLowBin = juce::jlimit(firstLowBin, numLowBins, (int)std::ceil(crossoverFrequency / lowBandBinWidth));
 
-        const int pathResolution = 2; //you can draw line-to's every 'pathResolution' pixels.
+            auto y = map(lows[(size_t)firstLowBin]);
+            jassert(!std::isnan(y) && !std::isinf(y));
+
+            p.startNewSubPath(0, y);
+            addBins(lows, lowBandBinWidth, firstLowBin + 1, endLowBin, 1);
 
-        for (int binNum = 1; binNum < numBins; binNum += pathResolution)
+            const auto firstBin = juce::jlimit(1, numBins, (int)std::ceil(crossoverFrequency / binWidth));
+            addBins(renderData, binWidth, firstBin, numBins, pathResolution);
+        }
+        else
         {
-            y = map(renderData[binNum]);
+            auto y = map(renderData[0]);
 
             jassert(!std::isnan(y) && !std::isinf(y));
 
-            if (!std::isnan(y) && !std::isinf(y))
-            {
-                auto binFreq = binNum * binWidth;
-                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
-                int binX = std::floor(normalizedBinX * width);
-                p.lineTo(binX, y);
-            }
+            p.startNewSubPath(0, y);
+
+            addBins(renderData, binWidth, 1, numBins, pathResolution);
         }
 
-        pathFifo.push(p);
+        pathFifo.commitWrite();
     }
 
     int getNumPathsAvailable() const
@@ -149,10 +225,199 @@ struct AnalyzerPathGenerator
     {
         return pathFifo.pull(path);
     }
+
+    size_t getMemoryUsage() const
+    {
+        return pathFifo.getMemoryUsage();
+    }
 private:
     Fifo<PathType> pathFifo;
 };
 
+enum class OctaveSmoothing
+{
+    None,
+    Third,
+    Sixth,
+    Twelfth,
+    TwentyFourth
+};
+
+/*
+ Fractional-octave smoothing, exponential averaging and peak hold for one analyzer spectrum.
+ Each bin's kernel is the band from k / 2^(fraction / 2) to k * 2^(fraction / 2), stored as its first and
+ one-past-last bin. The band mean comes from a running sum of power, so a frame costs O(bins) at any width.
+ Kernels are in bin units and only get rebuilt when the FFT size or the smoothing width changes.
+ */
+struct SpectrumSmoother
+{
+    struct Settings
+    {
+        OctaveSmoothing smoothing = OctaveSmoothing::None;
+        float averagingTimeMs = 0.f;         //time constant of the exponential average, 0 shows each frame as it comes
+        bool peakHold = false;
+        float peakDecayDbPerSecond = 12.f;
+    };
+
+    void setSettings(const Settings& newSettings);
+    const Settings& getSettings() const { return settings; }
+
+    /**
+     smooths 'renderData' (the dB values from FFTDataGenerator) in place.
+     'frameSeconds' is the time since the previous frame and sets the averaging and peak decay steps.
+     */
+    void process(std::vector<float>& renderData, int fftSize, double frameSeconds, float negativeInfinity);
+
+    //the held peaks, laid out like 'renderData'. empty unless peak hold is on
+    const std::vector<float>& getPeaks() const { return peaks; }
+
+    void reset();
+
+    size_t getMemoryUsage() const
+    {
+        return (kernelStart.capacity() + kernelEnd.capacity()) * sizeof(int)
+             + (kernelScale.capacity() + average.capacity() + peaks.capacity()) * sizeof(float)
+             + runningSum.capacity() * sizeof(double);
+    }
+private:
+    Settings settings;
+
+    int kernelFFTSize = 0;
+    OctaveSmoothing kernelSmoothing = OctaveSmoothing::None;
+    std::vector<int> kernelStart, kernelEnd;
+    std::vector<float> kernelScale;     //1 / (kernelEnd - kernelStart)
+    std::vector<double> runningSum;     //running sum of power, one longer than the bins
+
+    std::vector<float> average;         //power
+    std::vector<float> peaks;           //dB
+    bool hasHistory = false;
+
+    void updateKernels(int fftSize);
+};
+
+/*
+ Scrolling spectrogram: each FFT frame becomes one column of a preallocated image.
+ The write position wraps around and draw() splits the image at it, so no pixels
+ are ever moved and each frame costs O(height) regardless of how much history is kept.
+ */
+struct SpectrogramImage
+{
+    SpectrogramImage();
+
+    void prepare(int numColumns, int height);
+    void release();
+    bool isPrepared() const { return image.isValid(); }
+
+    void addFrame(const std::vector<float>& renderData, int fftSize, double sampleRate, float negativeInfinity);
+    void draw(juce::Graphics& g, juce::Rectangle<int> area) const;
+
+    size_t getMemoryUsage() const
+    {
+        return sizeof(*this) + (size_t)(image.getWidth() * image.getHeight()) * 3 + binForRow.capacity() * sizeof(int);
+    }
+private:
+    juce::Image image;
+    int writeColumn = 0;
+
+    //which fft bin each image row shows, on the same 20Hz - 20kHz log axis as the line analyzer
+    std::vector<int> binForRow;
+    int mappedFFTSize = 0;
+    double mappedSampleRate = 0;
+
+    static constexpr int lutSize = 256;
+    std::array<juce::Colour, lutSize> colourLut;
+
+    void updateBinMapping(int fftSize, double sampleRate);
+};
+
+/*
+ Records analyzer frames to disk for later inspection. The file is a fixed Header followed by fixed-size
+ records of { double timeInSeconds; float decibels[numBins]; }. It grows in chunks and is written through
+ a memory mapping by a background thread: the analyzer only copies frames into a ring, and drops (and
+ counts) frames if the writer falls behind. Header::numFrames is kept current, so a capture that was cut
+ short still reads back up to its last complete write.
+ */
+struct AnalyzerCapture : private juce::Thread
+{
+    struct Header
+    {
+        char magic[4]{ 'S', 'E', 'Q', 'C' };
+        juce::uint32 version{ 1 };
+        juce::uint32 fftSize{ 0 };
+        juce::uint32 numBins{ 0 };      //floats per record
+        double sampleRate{ 0 };         //of the analysed signal, after any decimation
+        juce::uint32 channel{ 0 };
+        float negativeInfinity{ 0 };    //the dB value silence is clamped to
+        juce::uint64 numFrames{ 0 };
+    };
+
+    static_assert(sizeof(Header) == 40, "the header layout is part of the file format");
+
+    AnalyzerCapture();
+    ~AnalyzerCapture() override;
+
+    //the file is replaced; recording starts with the first frame pushed
+    bool start(const juce::File& file, int channel);
+    void stop();
+    bool isCapturing() const { return isThreadRunning(); }
+
+    /**
+     called from the analyzer (message thread). Frames whose size or sample rate differ from the first one
+     are skipped, since a capture holds one format.
+     */
+    void pushFrame(const std::vector<float>& decibels, int fftSize, double sampleRate, double timeInSeconds, float negativeInfinity);
+
+    int getNumDroppedFrames() const { return numDropped.load(); }
+private:
+    static constexpr int ringCapacity = 256;
+    static constexpr juce::int64 growthSize = 16 * 1024 * 1024;
+
+    juce::File captureFile;
+    Header header;
+    double firstFrameTime{ 0 };
+
+    juce::AbstractFifo ring{ ringCapacity };
+    std::vector<float> ringFrames;      //ringCapacity * numBins
+    std::vector<double> ringTimes;
+    std::atomic<int> numDropped{ 0 };
+
+    //writer thread only
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    juce::int64 writePosition{ 0 };
+
+    void run() override;
+    void writePendingFrames();
+    bool reserve(juce::int64 size);
+    size_t getRecordSize() const { return sizeof(double) + header.numBins * sizeof(float); }
+};
+
+/*
+ Reads an AnalyzerCapture file through a read-only mapping and exports it as CSV
+ (one row per frame: time, then one column per bin) or as a spectrogram image.
+ */
+struct AnalyzerCaptureReader
+{
+    bool open(const juce::File& file);
+
+    const AnalyzerCapture::Header& getHeader() const { return header; }
+    juce::int64 getNumFrames() const { return numFrames; }
+
+    double getFrameTime(juce::int64 frameIndex) const;
+    const float* getFrame(juce::int64 frameIndex) const;
+
+    bool exportCsv(const juce::File& destination) const;
+
+    //one column per frame (frames are skipped to fit maxWidth), rows on the 20Hz - 20kHz log axis
+    juce::Image renderImage(int maxWidth, int height) const;
+    bool exportImage(const juce::File& destination, int maxWidth = 4096, int height = 512) const;
+private:
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    AnalyzerCapture::Header header;
+    juce::int64 numFrames{ 0 };
+    size_t recordSize{ 0 };
+
+    const char* getRecord(juce::int64 frameIndex) const;
+};
 
 struct LookAndFeel : juce::LookAndFeel_V4
 {
@@ -180,6 +445,12 @@ struct RotarySliderWithLabels : juce::Slider
         setLookAndFeel(&lnf);
     }
 
+    //binds to a parameter from the processor's table, with the unit the table gives it
+    RotarySliderWithLabels(juce::AudioProcessorValueTreeState& apvts, Parameters::ID id) :
+    RotarySliderWithLabels(*apvts.getParameter(Parameters::getID(id)), Parameters::table[(size_t)id].suffix)
+    {
+    }
+
     ~RotarySliderWithLabels()
     {
         setLookAndFeel(nullptr);
@@ -210,32 +481,105 @@ struct PathProducer
     {
         leftChannelFFTDataGenerator.changeOrder(FFTOrder::order2048);
         monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
+
+        lowBandFFTDataGenerator.changeOrder(FFTOrder::order2048);
+        lowBandBuffer.setSize(1, lowBandFFTDataGenerator.getFFTSize());
     }
 
     void process(juce::Rectangle<float> fftBounds, double sampleRate);
     juce::Path getPath() { return leftChannelFFTPath; }
+
+    //every FFT frame is also written to 'target' while it is set
+    void setSpectrogram(SpectrogramImage* target) { spectrogram = target; }
+
+    //every raw FFT frame is also recorded to 'target' while it is set
+    void setCapture(AnalyzerCapture* target) { capture = target; }
+    int getNumDroppedBuffers() const { return leftChannelFifo->getNumDroppedBuffers(); }
+
+    void setSmoothing(const SpectrumSmoother::Settings& settings)
+    {
+        smoother.setSettings(settings);
+        lowBandSmoother.setSettings(settings);
+    }
+
+    //the held peaks, empty unless the smoothing settings have peak hold on
+    juce::Path getPeakPath() { return peakHoldPath; }
+
+    //above 48kHz the input is halved before the FFTs so their bins all land in the displayed range. on by default
+    void setHighRateDecimationEnabled(bool enabled) { shouldDecimateHighRates = enabled; }
+
+    size_t getMemoryUsage() const
+    {
+        return sizeof(*this)
+            + getHeapBytes(monoBuffer)
+            + getHeapBytes(fftData)
+            + leftChannelFFTDataGenerator.getMemoryUsage()
+            + frontDecimators.capacity() * sizeof(HalfBandDecimator)
+            + frontScratch.capacity() * sizeof(float)
+            + getHeapBytes(lowBandBuffer)
+            + lowBandScratch.capacity() * sizeof(float)
+            + lowBandFFTData.capacity() * sizeof(float)
+            + lowBandFFTDataGenerator.getMemoryUsage()
+            + smoother.getMemoryUsage()
+            + lowBandSmoother.getMemoryUsage()
+            + pathProducer.getMemoryUsage()
+            + peakPathProducer.getMemoryUsage();
+    }
 private:
     SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* leftChannelFifo;
     juce::AudioBuffer<float> monoBuffer;
+    std::vector<float> fftData;
 
     FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
 
-    AnalyzerPathGenerator<juce::Path> pathProducer;
+    /*
+     High-rate decimation: one half-band stage per octave above 48kHz. Only the last stage has to keep
+     20kHz flat while rejecting what folds onto it, so it is the long one; the earlier stages run at
+     twice the rate or more and get by with the short default.
+     */
+    static constexpr int maxFrontDecimationStages = 3;
+    static constexpr int finalFrontDecimatorSideTaps = 20;
+    bool shouldDecimateHighRates = true;
+    int numFrontDecimationStages = 0;
+    std::vector<HalfBandDecimator> frontDecimators;
+    std::vector<float> frontScratch;
+
+    int getNumFrontDecimationStages(double sampleRate) const;
+    void prepareFrontDecimation(int numStages);
+
+    /*
+     The lows come from a second FFT of the same size run on the analysed signal decimated by a further 2^lowBandDecimationStages.
+     Its bins are that many times narrower (~2.9Hz at 48kHz, finer than an order8192 FFT) for the cost of
+     a short FFT per timer tick. It takes over below half the decimated Nyquist frequency.
+     */
+    static constexpr int lowBandDecimationStages = 3;
+    std::array<HalfBandDecimator, lowBandDecimationStages> lowBandDecimators;
+    juce::AudioBuffer<float> lowBandBuffer;
+    std::vector<float> lowBandScratch;
+    std::vector<float> lowBandFFTData;
+    int numNewLowBandSamples = 0;
+    double lowBandFrameSeconds = 0;
+
+    FFTDataGenerator<std::vector<float>> lowBandFFTDataGenerator;
+
+    SpectrumSmoother smoother, lowBandSmoother;
+
+    AnalyzerPathGenerator<juce::Path> pathProducer, peakPathProducer;
+
+    juce::Path leftChannelFFTPath, peakHoldPath;
 
-    juce::Path leftChannelFFTPath;
+    SpectrogramImage* spectrogram = nullptr;
+
+    AnalyzerCapture* capture = nullptr;
+    juce::int64 numAnalysedSamples = 0;     //at the analysis rate, for capture timestamps
 };
 
 struct ResponseCurveComponent : juce::Component,
-juce::AudioProcessorParameter::Listener,
 juce::Timer
 {
     ResponseCurveComponent(SimpleEQAudioProcessor&);
     ~ResponseCurveComponent(); 
 
-
-    void parameterValueChanged(int parameterIndex, float newValue) override;
-    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override {}
-
     void timerCallback() override;
 
     void paint(juce::Graphics& g) override;
@@ -246,15 +590,47 @@ juce::Timer
         shouldShowFFTAnalysis = enabled;
     }
 
+    void toggleSpectrogram(bool enabled);
+
+    //records the left (blue) analyzer channel's raw frames; see AnalyzerCapture
+    bool startCapture(const juce::File& file);
+    void stopCapture();
+    bool isCapturing() const { return capture.isCapturing(); }
+
+    void setAnalyzerSmoothing(const SpectrumSmoother::Settings& settings)
+    {
+        leftPathProducer.setSmoothing(settings);
+        rightPathProducer.setSmoothing(settings);
+        keyPathProducer.setSmoothing(settings);
+    }
+
+    void setHighRateDecimationEnabled(bool enabled)
+    {
+        leftPathProducer.setHighRateDecimationEnabled(enabled);
+        rightPathProducer.setHighRateDecimationEnabled(enabled);
+        keyPathProducer.setHighRateDecimationEnabled(enabled);
+    }
+
+    size_t getAnalyzerMemoryUsage() const
+    {
+        return leftPathProducer.getMemoryUsage() + rightPathProducer.getMemoryUsage() + keyPathProducer.getMemoryUsage()
+             + spectrogram.getMemoryUsage();
+    }
+
     private:
         SimpleEQAudioProcessor& audioProcessor;
-        juce::Atomic<bool> parametersChanged{ false };
-        
-        MonoChain monoChain;
+        SimpleEQAudioProcessor::AnalyzerFifos& analyzerFifos;
+
+        //built from the processor's published coefficients, so it always shows what is being played.
+        juce::Path responseCurve;
 
-        void updateChain();
+        void updateResponseCurve();
 
         juce::Image background;
+        float backgroundScale{ 1.f };
+
+        juce::Image getGridBackground(float scale);
+        void drawBackgroundGrid(juce::Graphics& g);
 
         juce::Rectangle<int> getRenderArea();
 
@@ -262,11 +638,78 @@ juce::Timer
 
         PathProducer leftPathProducer, rightPathProducer;
 
+        //the sidechain spectrum; stays empty while the key input is disconnected
+        PathProducer keyPathProducer;
+
+        //shows the left (blue) analyzer channel
+        SpectrogramImage spectrogram;
+
+        AnalyzerCapture capture;
+
         bool shouldShowFFTAnalysis = true;
+        bool shouldShowSpectrogram = false;
+};
+/*
+ Offline spectrum match: long-term average spectra of a reference and a target file, and the EQ settings
+ that take the target towards the reference. Each file is split into one run of frames per core, and every
+ run streams through its own reader and FFTDataGenerator on a thread pool, so memory use doesn't grow with
+ the file's length.
+ */
+struct SpectrumMatcher
+{
+    struct AverageSpectrum
+    {
+        std::vector<double> power;  //mean power per bin
+        double sampleRate{ 0 };
+        int fftSize{ 0 };
+    };
+
+    //false if the file can't be read, is shorter than one FFT, or 'shouldExit' was set part way through
+    static bool computeAverageSpectrum(const juce::File& file, AverageSpectrum& result, const std::atomic<bool>& shouldExit);
+
+    //the settings that make 'target' sound more like 'reference'
+    static ChainSettings match(const AverageSpectrum& reference, const AverageSpectrum& target);
+};
+
+//runs a match off the message thread, then calls 'onFinished' back on it
+struct SpectrumMatchThread : juce::Thread
+{
+    using Callback = std::function<void(bool succeeded, const ChainSettings& settings)>;
+
+    SpectrumMatchThread(const juce::File& reference, const juce::File& target, Callback callback);
+    ~SpectrumMatchThread() override;
+
+    void run() override;
+private:
+    juce::File referenceFile, targetFile;
+    Callback onFinished;
+    std::atomic<bool> shouldExit{ false };
+};
+
+/*
+ Input and output meters: peak/RMS bars per channel with true peak, momentary and short-term loudness below.
+ The processor only measures while this is switched on.
+ */
+struct LevelMeterComponent : juce::Component,
+juce::Timer
+{
+    LevelMeterComponent(SimpleEQAudioProcessor&);
+    ~LevelMeterComponent();
+
+    void setMeteringEnabled(bool enabled);
+
+    void timerCallback() override;
+    void paint(juce::Graphics& g) override;
+private:
+    SimpleEQAudioProcessor& audioProcessor;
+    bool isMetering = false;
+
+    void drawMeter(juce::Graphics& g, juce::Rectangle<int> area, const MeterReadings& readings, const juce::String& title);
 };
 //==============================================================================
 
 struct PowerButton : juce::ToggleButton {};
+struct SpectrogramButton : juce::ToggleButton {};
 struct AnalyzerButton : juce::ToggleButton
 {
     void resized() override
@@ -300,32 +743,72 @@ public:
 
     //==============================================================================
     void paint (juce::Graphics&) override;
+    void paintOverChildren (juce::Graphics&) override;
     void resized() override;
 
+    size_t getAnalyzerMemoryUsage() const { return responseCurveComponent.getAnalyzerMemoryUsage(); }
+
+    //milliseconds from construction until the first complete paint, or -1 if it hasn't painted yet
+    double getTimeToFirstPaintMs() const { return timeToFirstPaintMs; }
+
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     SimpleEQAudioProcessor& audioProcessor;
 
-    RotarySliderWithLabels peakFreqSlider, peakGainSlider, peakQSlider, lowCutFreqSlider, highCutFreqSlider, 
-                       lowCutShapeSlider, highCutShapeSlider;
+    juce::int64 constructionTicks;
+    double timeToFirstPaintMs{ -1 };
+
+    //one per table entry flagged Parameters::Control::Rotary, indexed by Parameters::ID
+    std::array<std::unique_ptr<RotarySliderWithLabels>, Parameters::numParameters> sliders;
+    RotarySliderWithLabels& getSlider(Parameters::ID id) { return *sliders[(size_t)id]; }
 
     using APVTS = juce::AudioProcessorValueTreeState;
     using Attachment = APVTS::SliderAttachment;
 
-    Attachment peakFreqSliderAttachment, peakGainSliderAttachment, peakQSliderAttachment, 
-               lowCutFreqSliderAttachment, highCutFreqSliderAttachment,
-               lowCutShapeSliderAttachment, highCutShapeSliderAttachment;
-
     PowerButton lowCutBypassButton, highCutBypassButton, peakBypassButton;
     AnalyzerButton analyzerEnableButton;
+    SpectrogramButton spectrogramButton;
 
     using ButtonAttachment = APVTS::ButtonAttachment;
-    ButtonAttachment lowCutBypassAttachment, highCutBypassAttachment, peakBypassAttachment, analyzerEnableAttachment;
+
+    juce::ComboBox stereoModeBox;
+    //72 and 96 dB/oct, below the shape knobs; see ExtendedSlope
+    juce::ComboBox lowCutExtendedSlopeBox, highCutExtendedSlopeBox;
+
+    //analyzer display settings; these belong to the editor, not the plugin state
+    juce::ComboBox analyzerSmoothingBox;
+    juce::ToggleButton peakHoldButton{ "Peak Hold" };
+
+    void updateAnalyzerSmoothing();
 
 
     ResponseCurveComponent responseCurveComponent;
 
+    LevelMeterComponent levelMeters;
+    juce::ToggleButton meteringButton{ "Meters" };
+
+    juce::ToggleButton autoGainButton{ "Auto Gain" };
+
+    //made by iterating the table's editor flags; declared after every control so they are destroyed first
+    std::vector<std::unique_ptr<Attachment>> sliderAttachments;
+    std::vector<std::unique_ptr<ButtonAttachment>> buttonAttachments;
+    std::vector<std::unique_ptr<APVTS::ComboBoxAttachment>> comboBoxAttachments;
+
+    void createAttachments();
+    juce::Button& getButton(Parameters::ID id);
+    juce::ComboBox& getComboBox(Parameters::ID id);
+
+    //fits the EQ so one file sounds like another; see SpectrumMatcher
+    juce::TextButton matchButton{ "Match EQ..." };
+    juce::ToggleButton captureButton{ "Capture" };
+    std::unique_ptr<juce::FileChooser> referenceChooser, targetChooser;
+    std::unique_ptr<SpectrumMatchThread> matchThread;
+
+    void chooseMatchFiles();
+    void startMatch(const juce::File& reference, const juce::File& target);
+    void applyMatch(const ChainSettings& settings, const juce::File& target);
+
     std::vector<juce::Component*> getComps();
 
     LookAndFeel lnf;
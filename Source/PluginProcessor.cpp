@@ -10,6 +10,23 @@
 #include "PluginEditor.h"
 
 //==============================================================================
+namespace
+{
+    template<size_t... Index>
+    void prepareCutCoefficients(CutFilter& cut, std::index_sequence<Index...>)
+    {
+        ((*cut.template get<Index>().coefficients = juce::dsp::IIR::Coefficients<float>(1.f, 0.f, 0.f, 1.f, 0.f, 0.f)), ...);
+    }
+
+    //gives every filter a biquad-sized coefficient object, so new designs can be written in place
+    void prepareCoefficients(MonoChain& chain)
+    {
+        *chain.get<ChainPositions::Peak>().coefficients = juce::dsp::IIR::Coefficients<float>(1.f, 0.f, 0.f, 1.f, 0.f, 0.f);
+        prepareCutCoefficients(chain.get<ChainPositions::LowCut>(), std::make_index_sequence<CutDesign::maxStages>());
+        prepareCutCoefficients(chain.get<ChainPositions::HighCut>(), std::make_index_sequence<CutDesign::maxStages>());
+    }
+}
+
 SimpleEQAudioProcessor::SimpleEQAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
      : AudioProcessor (BusesProperties()
@@ -18,14 +35,36 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                      #endif
                        )
 #endif
 {
+    parameterValues.attach(apvts);
+
+    for (int i = 0; i < BandEngine::maxBands; ++i)
+        for (size_t j = 0; j < Parameters::bandParameterTable.size(); ++j)
+            bandParameters[(size_t)i][j] = apvts.getRawParameterValue(getBandParameterID(i, Parameters::bandParameterTable[j].id));
+
+    for (const auto& descriptor : Parameters::table)
+        presetParameters.push_back(apvts.getParameter(descriptor.id));
+
+    for (int i = 0; i < BandEngine::maxBands; ++i)
+        for (const auto& descriptor : Parameters::bandParameterTable)
+            presetParameters.push_back(apvts.getParameter(getBandParameterID(i, descriptor.id)));
+
+    prepareCoefficients(leftChain);
+    prepareCoefficients(rightChain);
+    prepareCoefficients(outgoingLeftChain);
+    prepareCoefficients(outgoingRightChain);
+    CutDesign::prepareTables();
+
+    startTimerHz(autoGainPollHz);
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -63,7 +102,7 @@ bool SimpleEQAudioProcessor::isMidiEffect() const
 
 double SimpleEQAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load();
 }
 
 int SimpleEQAudioProcessor::getNumPrograms()
@@ -91,6 +130,298 @@ void SimpleEQAudioProcessor::changeProgramName (int index, const juce::String& n
 }
 
 //==============================================================================
+namespace
+{
+    //a stage that is off is bypassed in the chain; it is cleared before it is switched back on
+    template<int Index>
+    void setStageActive(MonoChain& chain, StageFade& fade, bool shouldBeActive)
+    {
+        if (shouldBeActive && chain.template isBypassed<Index>())
+        {
+            chain.template get<Index>().reset();
+            chain.template setBypassed<Index>(false);
+        }
+
+        fade.setActive(shouldBeActive);
+    }
+
+    template<int Index>
+    void snapStage(MonoChain& chain, StageFade& fade)
+    {
+        fade.snap();
+        chain.template setBypassed<Index>(!fade.active);
+    }
+
+    void snapStages(MonoChain& chain, StageFades& fades)
+    {
+        snapStage<ChainPositions::LowCut>(chain, fades[ChainPositions::LowCut]);
+        snapStage<ChainPositions::Peak>(chain, fades[ChainPositions::Peak]);
+        snapStage<ChainPositions::HighCut>(chain, fades[ChainPositions::HighCut]);
+    }
+
+    //'dry' must hold at least one fade length of samples
+    template<int Index>
+    void processStage(MonoChain& chain, StageFade& fade, juce::dsp::AudioBlock<float>& block, float* dry)
+    {
+        if (chain.template isBypassed<Index>())
+            return;
+
+        auto& stage = chain.template get<Index>();
+
+        if (!fade.isFading())
+        {
+            juce::dsp::ProcessContextReplacing<float> context(block);
+            stage.process(context);
+            return;
+        }
+
+        const auto numSamples = (int)block.getNumSamples();
+        const auto numToFade = juce::jmin(fade.getNumRemaining(), numSamples);
+
+        auto fadeBlock = block.getSubBlock(0, (size_t)numToFade);
+        auto* samples = fadeBlock.getChannelPointer(0);
+        std::copy(samples, samples + numToFade, dry);
+
+        juce::dsp::ProcessContextReplacing<float> fadeContext(fadeBlock);
+        stage.process(fadeContext);
+
+        for (int i = 0; i < numToFade; ++i)
+            samples[i] = dry[i] + fade.getNextGain() * (samples[i] - dry[i]);
+
+        //a finished fade-out leaves the rest of the block dry
+        if (!fade.active)
+        {
+            if (!fade.isFading())
+                chain.template setBypassed<Index>(true);
+            return;
+        }
+
+        if (numToFade < numSamples)
+        {
+            auto rest = block.getSubBlock((size_t)numToFade);
+            juce::dsp::ProcessContextReplacing<float> restContext(rest);
+            stage.process(restContext);
+        }
+    }
+
+    //what one channel runs, in order: the three chain stages (by ChainPositions), then the band engine
+    constexpr int bandsUnit = 3, numUnits = 4;
+
+    bool isUnitActive(const MonoChain& chain, const BandEngine& bands, int unit)
+    {
+        switch (unit)
+        {
+            case ChainPositions::LowCut: return !chain.isBypassed<ChainPositions::LowCut>();
+            case ChainPositions::Peak: return !chain.isBypassed<ChainPositions::Peak>();
+            case ChainPositions::HighCut: return !chain.isBypassed<ChainPositions::HighCut>();
+            default: return bands.getNumStages() > 0;
+        }
+    }
+
+    //one unit over one channel of the block, in place
+    void processUnit(MonoChain& chain, StageFades& fades, BandEngine& bands, int unit, int channel,
+                     juce::dsp::AudioBlock<float>& block, float* dry)
+    {
+        switch (unit)
+        {
+            case ChainPositions::LowCut: processStage<ChainPositions::LowCut>(chain, fades[ChainPositions::LowCut], block, dry); break;
+            case ChainPositions::Peak: processStage<ChainPositions::Peak>(chain, fades[ChainPositions::Peak], block, dry); break;
+            case ChainPositions::HighCut: processStage<ChainPositions::HighCut>(chain, fades[ChainPositions::HighCut], block, dry); break;
+            default: bands.process(block.getChannelPointer(0), (int)block.getNumSamples(), channel); break;
+        }
+    }
+
+    /*
+     One unit of one channel, run a sample at a time by the loops that also do the Mid/Side matrix.
+     Mirrors processStage(): a fading stage is mixed with its input, and once it has faded out the rest
+     passes through. An empty SampleStage passes everything through.
+     */
+    struct SampleStage
+    {
+        std::array<Filter*, CutDesign::maxStages> filters{};
+        int numFilters{ 0 };
+        StageFade* fade{ nullptr };
+        BandEngine* bands{ nullptr };
+        int channel{ 0 };
+
+        float process(float x) noexcept
+        {
+            if (fade == nullptr)
+                return run(x);
+
+            if (fade->isFading())
+            {
+                const auto gain = fade->getNextGain();
+                return x + gain * (run(x) - x);
+            }
+
+            return fade->active ? run(x) : x;
+        }
+
+    private:
+        float run(float x) noexcept
+        {
+            for (int i = 0; i < numFilters; ++i)
+                x = filters[(size_t)i]->processSample(x);
+
+            return bands != nullptr ? bands->processSample(x, channel) : x;
+        }
+    };
+
+    template<size_t... Index>
+    void addCutFilters(CutFilter& cut, SampleStage& stage, std::index_sequence<Index...>)
+    {
+        ((cut.isBypassed<(int)Index>() ? void() : void(stage.filters[(size_t)stage.numFilters++] = &cut.get<(int)Index>())), ...);
+    }
+
+    SampleStage makeSampleStage(MonoChain& chain, StageFades& fades, BandEngine& bands, int unit, int channel)
+    {
+        SampleStage stage;
+
+        switch (unit)
+        {
+            case ChainPositions::LowCut:
+                addCutFilters(chain.get<ChainPositions::LowCut>(), stage, std::make_index_sequence<CutDesign::maxStages>());
+                break;
+            case ChainPositions::Peak:
+                stage.filters[0] = &chain.get<ChainPositions::Peak>();
+                stage.numFilters = 1;
+                break;
+            case ChainPositions::HighCut:
+                addCutFilters(chain.get<ChainPositions::HighCut>(), stage, std::make_index_sequence<CutDesign::maxStages>());
+                break;
+            default:
+                stage.bands = &bands;
+                stage.channel = channel;
+                return stage;
+        }
+
+        stage.fade = &fades[(size_t)unit];
+        return stage;
+    }
+
+    //processStage() bypasses a stage once it has faded out; the per-sample loops leave that to here
+    void bypassIfFadedOut(MonoChain& chain, const StageFades& fades, int unit)
+    {
+        if (unit == bandsUnit || fades[(size_t)unit].active || fades[(size_t)unit].isFading())
+            return;
+
+        switch (unit)
+        {
+            case ChainPositions::LowCut: chain.setBypassed<ChainPositions::LowCut>(true); break;
+            case ChainPositions::Peak: chain.setBypassed<ChainPositions::Peak>(true); break;
+            case ChainPositions::HighCut: chain.setBypassed<ChainPositions::HighCut>(true); break;
+            default: break;
+        }
+    }
+
+    /*
+     Runs a pair of chains and their band engine over a block that comes in and goes out as L/R.
+     In the mid/side modes the first chain filters Mid and the second Side, and the matrix costs no pass
+     of its own: it is folded into the per-sample loops of each channel's first and last active units.
+     The first loop reads L/R and writes filtered M/S, the units in between run in place one at a time,
+     and the last loop filters and writes L/R. With only one unit per channel, one loop does all of it.
+     */
+    void processChainPair(MonoChain& midChain, StageFades& midFades, MonoChain& sideChain, StageFades& sideFades,
+                          BandEngine& bands, StereoMode mode, juce::dsp::AudioBlock<float>& block, float* dry)
+    {
+        const auto numChannels = juce::jmin((int)block.getNumChannels(), 2);
+        const auto numSamples = (int)block.getNumSamples();
+
+        MonoChain* chains[] = { &midChain, &sideChain };
+        StageFades* fades[] = { &midFades, &sideFades };
+
+        //Mid Only leaves Side untouched and Side Only leaves Mid untouched, band engine included
+        const bool isFiltered[] = { mode != StereoMode::SideOnly, mode != StereoMode::MidOnly };
+        const auto channelMask = (isFiltered[0] ? 1 : 0) | (isFiltered[1] ? 2 : 0);
+
+        std::array<std::array<int, numUnits>, 2> units{};
+        std::array<int, 2> numActive{};
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int unit = 0; unit < bandsUnit; ++unit)
+                if (isFiltered[ch] && isUnitActive(*chains[ch], bands, unit))
+                    units[(size_t)ch][(size_t)numActive[(size_t)ch]++] = unit;
+
+        if (mode == StereoMode::LeftRightLinked || numChannels < 2)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto channelBlock = block.getSingleChannelBlock((size_t)ch);
+                for (int i = 0; i < numActive[(size_t)ch]; ++i)
+                    processUnit(*chains[ch], *fades[ch], bands, units[(size_t)ch][(size_t)i], ch, channelBlock, dry);
+            }
+
+            bands.process(block, channelMask);
+            return;
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            if (isFiltered[ch] && isUnitActive(*chains[ch], bands, bandsUnit))
+                units[(size_t)ch][(size_t)numActive[(size_t)ch]++] = bandsUnit;
+
+        //with nothing to filter, encoding and decoding would only cancel out
+        const auto numLoops = juce::jmax(numActive[0], numActive[1]);
+        if (numLoops == 0)
+            return;
+
+        //a channel with a single unit runs it in the first loop and just passes through the last
+        std::array<SampleStage, 2> first, last;
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            const auto& channelUnits = units[(size_t)ch];
+            const auto count = numActive[(size_t)ch];
+
+            if (count > 0)
+                first[(size_t)ch] = makeSampleStage(*chains[ch], *fades[ch], bands, channelUnits[0], ch);
+            if (count > 1)
+                last[(size_t)ch] = makeSampleStage(*chains[ch], *fades[ch], bands, channelUnits[(size_t)count - 1], ch);
+        }
+
+        auto* left = block.getChannelPointer(0);
+        auto* right = block.getChannelPointer(1);
+
+        if (numLoops == 1)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto mid = first[0].process(0.5f * (left[i] + right[i]));
+                const auto side = first[1].process(0.5f * (left[i] - right[i]));
+                left[i] = mid + side;
+                right[i] = mid - side;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto l = left[i], r = right[i];
+                left[i] = first[0].process(0.5f * (l + r));
+                right[i] = first[1].process(0.5f * (l - r));
+            }
+
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                auto channelBlock = block.getSingleChannelBlock((size_t)ch);
+                for (int i = 1; i < numActive[(size_t)ch] - 1; ++i)
+                    processUnit(*chains[ch], *fades[ch], bands, units[(size_t)ch][(size_t)i], ch, channelBlock, dry);
+            }
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto mid = last[0].process(left[i]);
+                const auto side = last[1].process(right[i]);
+                left[i] = mid + side;
+                right[i] = mid - side;
+            }
+        }
+
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < numActive[(size_t)ch]; ++i)
+                bypassIfFadedOut(*chains[ch], *fades[ch], units[(size_t)ch][(size_t)i]);
+    }
+}
+
 void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     // Use this method as the place to do any pre-playback
@@ -103,10 +434,48 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     
     leftChain.prepare(spec);
     rightChain.prepare(spec);
+    outgoingLeftChain.prepare(spec);
+    outgoingRightChain.prepare(spec);
+
+    //prepared whichever engine is chosen below, so the scratch sizes cover the oversampled one
+    oversampling.initProcessing((size_t)samplesPerBlock);
+    keyOversampling.initProcessing((size_t)samplesPerBlock);
+    fadeScratch.assign((size_t)juce::roundToInt(sampleRate * oversampling.getOversamplingFactor() * 0.005) + 1, 0.f);
+    presetFadeBuffer.setSize(2, samplesPerBlock * (int)oversampling.getOversamplingFactor());
+
+    //nothing is playing, so a preset switched to in the meantime is simply in the parameters already
+    if (pendingPresets.update())
+        presetSwitchesApplied = pendingPresets.read().serial;
+
+    /*
+     The engine is only ever chosen here. Switching mid-stream would mean resetting every filter (a click)
+     and reporting the new latency from the audio thread, after the host has started rendering with the
+     old one. A host that flips to offline without preparing us again keeps the realtime engine.
+     */
+    selectEngine(isNonRealtime());
+    setLatencySamples(getEngineLatency());
+
+    inputMeter.prepare(sampleRate);
+    outputMeter.prepare(sampleRate);
+
+    autoGain.reset(sampleRate, 0.05);
+    autoGain.setCurrentAndTargetValue(autoGainTarget.load());
+
+    silentSamples = 0;
+    isSleeping = false;
     updateFilters();
 
-    leftChannelFifo.prepare(samplesPerBlock);
-    rightChannelFifo.prepare(samplesPerBlock);
+    //nothing is playing yet, so start every stage in its final state instead of fading
+    snapStages(leftChain, leftFades);
+    snapStages(rightChain, rightFades);
+
+    analyzerBufferSize = samplesPerBlock;
+    if (analyzerFifosStorage != nullptr)
+    {
+        analyzerFifosStorage->leftChannelFifo.prepare(samplesPerBlock);
+        analyzerFifosStorage->rightChannelFifo.prepare(samplesPerBlock);
+        analyzerFifosStorage->keyChannelFifo.prepare(samplesPerBlock);
+    }
 }
 
 void SimpleEQAudioProcessor::releaseResources()
@@ -136,6 +505,16 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
         return false;
    #endif
 
+    // The optional key input may be disconnected, mono or stereo.
+    if (layouts.inputBuses.size() > 1)
+    {
+        auto keySet = layouts.getChannelSet(true, 1);
+        if (!keySet.isDisabled()
+         && keySet != juce::AudioChannelSet::mono()
+         && keySet != juce::AudioChannelSet::stereo())
+            return false;
+    }
+
     return true;
   #endif
 }
@@ -156,22 +535,526 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    updateFilters();
+    //the key input only costs anything when the host has actually connected it
+    auto mainBuffer = getBusBuffer(buffer, true, 0);
+    auto keyBuffer = getBusBuffer(buffer, true, 1);
+
+    //meters restart from silence whenever they are switched back on
+    const auto shouldMeter = meteringEnabled.load(std::memory_order_relaxed);
+    if (shouldMeter && !wasMetering)
+    {
+        inputMeter.reset();
+        outputMeter.reset();
+    }
+    wasMetering = shouldMeter;
+
+    if (shouldMeter)
+        inputMeter.process(mainBuffer);
+
+    const auto numSamples = mainBuffer.getNumSamples();
+    const auto shouldSleep = updateSilenceState(mainBuffer);
+
+    //a new preset is only taken over once the crossfade to the last one is done
+    if (!presetFade.isFading() && pendingPresets.update())
+        startPresetCrossfade(pendingPresets.read());
+
+    const auto isSwitchingPreset = presetSwitchesRequested.load(std::memory_order_acquire) != presetSwitchesApplied;
+    const auto numSubBlocks = shouldSleep || isSwitchingPreset ? 1 : getNumAutomationSubBlocks(numSamples);
+
+    if (numSubBlocks == 1)
+    {
+        if (!isSwitchingPreset)
+            updateFilters();
+
+        processSubBlock(mainBuffer, keyBuffer, shouldSleep);
+    }
+    else
+    {
+        //the host only gives us one value per parameter per block: instead of stepping to it at the
+        //block boundary, the continuous parameters are ramped towards it one sub-block at a time
+        rampStartSettings = currentSettings;
+        rampStartSideSettings = currentSideSettings;
+
+        for (int i = 0; i < numSubBlocks; ++i)
+        {
+            const auto start = numSamples * i / numSubBlocks;
+            const auto end = numSamples * (i + 1) / numSubBlocks;
+
+            //the offline engine glides to each design a sample at a time instead of stepping to it
+            if (isHighQuality)
+                coefficientRamp.begin(leftChain, rightChain);
+
+            updateFilters((float)(i + 1) / (float)numSubBlocks);
+
+            if (isHighQuality)
+                coefficientRamp.start((end - start) * (int)oversampling.getOversamplingFactor(), !currentSettings.peakDynamic,
+                                      !currentSettings.peakDynamic || currentStereoMode == StereoMode::MidSide);
+
+            juce::AudioBuffer<float> mainSubBlock(mainBuffer.getArrayOfWritePointers(), mainBuffer.getNumChannels(), start, end - start);
+            juce::AudioBuffer<float> keySubBlock(keyBuffer.getArrayOfWritePointers(), keyBuffer.getNumChannels(), start, end - start);
+            processSubBlock(mainSubBlock, keySubBlock, false);
+        }
+    }
+
+    //switching auto gain on needs a first estimate even if nothing else changes
+    const auto shouldAutoGain = parameterValues.isOn(Parameters::AutoGain);
+    if (shouldAutoGain && !wasAutoGain)
+        publishCoefficients();
+    wasAutoGain = shouldAutoGain;
+
+    autoGain.setTargetValue(shouldAutoGain ? autoGainTarget.load() : 1.f);
+    if (autoGain.isSmoothing() || autoGain.getTargetValue() != 1.f)
+        autoGain.applyGain(mainBuffer, numSamples);
+
+    if (shouldMeter)
+    {
+        outputMeter.process(mainBuffer);
+
+        auto& snapshot = meterSnapshots.getWriteSlot();
+        snapshot.input = inputMeter.getReadings();
+        snapshot.output = outputMeter.getReadings();
+        meterSnapshots.publish();
+    }
+}
+
+/*
+ The offline engine runs the filters 4x oversampled, which takes the bilinear-transform cramping near
+ Nyquist well out of the audible range. Automated filters are redesigned every highQualitySubBlockLength
+ oversampled samples, and CoefficientRamp interpolates the coefficients between those designs every
+ sample, so a ramp has no steps at all while designing still costs little next to the filtering.
+ */
+void SimpleEQAudioProcessor::selectEngine(bool shouldUseHighQuality)
+{
+    isHighQuality = shouldUseHighQuality;
+    processingSampleRate = getSampleRate() * (isHighQuality ? (double)oversampling.getOversamplingFactor() : 1.0);
+
+    presetSampleRate.store(processingSampleRate);
+
+    bandEngine.prepare(processingSampleRate);
+    outgoingBandEngine.prepare(processingSampleRate);
+    dynamicPeak.prepare(processingSampleRate);
+    leftChain.reset();
+    rightChain.reset();
+    oversampling.reset();
+    keyOversampling.reset();
+
+    //5 ms fades when a stage is switched in or out
+    const auto fadeLength = juce::jlimit(1, (int)fadeScratch.size(), juce::roundToInt(processingSampleRate * 0.005));
+    for (auto* fades : { &leftFades, &rightFades })
+        for (auto& fade : *fades)
+            fade.length = fadeLength;
+
+    snapStages(leftChain, leftFades);
+    snapStages(rightChain, rightFades);
+    coefficientRamp.cancel();
+
+    //a preset crossfade in progress is cut short: its old chains would need redesigning too
+    presetFade.length = juce::roundToInt(processingSampleRate * 0.02);
+    presetFade.snap();
+
+    filtersNeedUpdate = true;
+}
+
+int SimpleEQAudioProcessor::getEngineLatency() const
+{
+    return isHighQuality ? juce::roundToInt(oversampling.getLatencyInSamples()) : 0;
+}
+
+void SimpleEQAudioProcessor::timerCallback()
+{
+    if (autoGainCoefficients.update())
+        autoGainTarget.store(getCompensationGain(autoGainCoefficients.read()));
+}
+
+/*
+ The gain that keeps pink noise at the same level through the chain: pink noise has equal power per octave,
+ so that is the mean power gain over log-spaced frequencies from 20Hz to 20kHz. Limited to +/-12 dB.
+ */
+float SimpleEQAudioProcessor::getCompensationGain(const ChainCoefficients& coefficients)
+{
+    if (coefficients.sampleRate <= 0)
+        return 1.f;
+
+    constexpr int pointsPerOctave = 12;
+    const auto numPoints = (int)std::ceil(std::log2(20000.0 / 20.0) * pointsPerOctave) + 1;
+    const auto maxFrequency = coefficients.sampleRate * 0.5;
+
+    auto sum = 0.0;
+    int numUsed = 0;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto frequency = 20.0 * std::pow(2.0, (double)i / pointsPerOctave);
+        if (frequency >= maxFrequency)
+            break;
+
+        const auto magnitude = coefficients.getMagnitudeForFrequency(frequency);
+        sum += magnitude * magnitude;
+        ++numUsed;
+    }
+
+    if (numUsed == 0 || sum <= 0.0)
+        return 1.f;
+
+    const auto limit = juce::Decibels::decibelsToGain(12.0);
+    return (float)juce::jlimit(1.0 / limit, limit, 1.0 / std::sqrt(sum / numUsed));
+}
+
+int SimpleEQAudioProcessor::getNumAutomationSubBlocks(int numSamples)
+{
+    const auto minimumLength = isHighQuality ? juce::jmax(1, highQualitySubBlockLength / (int)oversampling.getOversamplingFactor())
+                                             : minimumSubBlockLength.load();
+    if (minimumLength <= 0 || numSamples < 2 * minimumLength)
+        return 1;
+
+    //a mode or sample rate change is applied as a step, like any other discrete change
+    auto stereoMode = static_cast<StereoMode>(parameterValues.get(Parameters::StereoMode));
+    if (filtersNeedUpdate || stereoMode != currentStereoMode || processingSampleRate != currentSampleRate)
+        return 1;
+
+    auto isRamping = hasContinuousChange(currentSettings, getChainSettings(parameterValues));
+    if (!isRamping && stereoMode == StereoMode::MidSide)
+        isRamping = hasContinuousChange(currentSideSettings, getSideChainSettings(parameterValues));
+
+    return isRamping ? numSamples / minimumLength : 1;
+}
+
+void SimpleEQAudioProcessor::processSubBlock(juce::AudioBuffer<float>& mainBuffer, juce::AudioBuffer<float>& keyBuffer, bool shouldSleep)
+{
+    const auto hasKey = keyBuffer.getNumChannels() > 0;
+
+    juce::dsp::AudioBlock<float> block(mainBuffer);
+
+    //the buffer stays L/R throughout: the chains do the Mid/Side matrix inside their own loops
+    const auto isMidSide = !shouldSleep && currentStereoMode != StereoMode::LeftRightLinked && mainBuffer.getNumChannels() > 1;
+
+    if (shouldSleep)
+    {
+        mainBuffer.clear();
+        presetFade.snap();
+    }
+    else
+    {
+        auto processingBlock = isHighQuality ? oversampling.processSamplesUp(block) : block;
+
+        //after a preset switch the old chains run on a copy of the input until they are faded out
+        const auto numToCrossfade = juce::jmin(presetFade.getNumRemaining(), (int)processingBlock.getNumSamples());
+        auto outgoingBlock = juce::dsp::AudioBlock<float>(presetFadeBuffer)
+                                 .getSubsetChannelBlock(0, processingBlock.getNumChannels())
+                                 .getSubBlock(0, (size_t)numToCrossfade);
+
+        if (numToCrossfade > 0)
+            outgoingBlock.copyFrom(processingBlock.getSubBlock(0, (size_t)numToCrossfade));
+
+        if (currentSettings.peakDynamic && !currentSettings.peakBypass)
+        {
+            juce::dsp::AudioBlock<float> keyBlock(keyBuffer);
+            const auto useKey = hasKey && currentSettings.peakSidechain;
+
+            if (useKey && isHighQuality)
+                keyBlock = keyOversampling.processSamplesUp(keyBlock);
+
+            processChainsWithDynamicPeak(processingBlock, useKey ? &keyBlock : nullptr);
+        }
+        else
+        {
+            processChains(processingBlock);
+        }
+
+        if (numToCrossfade > 0)
+        {
+            //both sides are L/R, whatever stereo mode each set of chains runs in
+            processOutgoingChains(outgoingBlock);
+
+            for (int i = 0; i < numToCrossfade; ++i)
+            {
+                const auto gain = presetFade.getNextGain();
+
+                for (size_t ch = 0; ch < processingBlock.getNumChannels(); ++ch)
+                {
+                    auto* samples = processingBlock.getChannelPointer(ch);
+                    const auto old = outgoingBlock.getSample((int)ch, i);
+                    samples[i] = old + gain * (samples[i] - old);
+                }
+            }
+        }
+
+        if (isHighQuality)
+            oversampling.processSamplesDown(block);
+    }
+
+    //releaseAnalyzerFifos() waits for analyzerInUse to drop before freeing the fifos
+    analyzerInUse.store(true);
+    if (auto* fifos = analyzerFifos.load())
+    {
+        //in the mid/side modes the analyzer shows Mid and Side, formed as the fifos copy the samples
+        fifos->leftChannelFifo.update(mainBuffer, isMidSide);
+        fifos->rightChannelFifo.update(mainBuffer, isMidSide);
+
+        if (hasKey)
+            fifos->keyChannelFifo.update(keyBuffer);
+    }
+    analyzerInUse.store(false, std::memory_order_release);
+}
+
+//returns true if this block can be skipped: silent input, and the tail of the last signal has rung out
+bool SimpleEQAudioProcessor::updateSilenceState(const juce::AudioBuffer<float>& input)
+{
+    const auto numSamples = input.getNumSamples();
+    const auto isSilent = input.getMagnitude(0, numSamples) < 1.0e-6f;   //-120 dBFS
+
+    if (!isSilent)
+    {
+        //whatever is left in the filters is below the silence threshold by now
+        if (isSleeping)
+        {
+            leftChain.reset();
+            rightChain.reset();
+            bandEngine.reset();
+            dynamicPeak.reset();
+            isSleeping = false;
+        }
+
+        silentSamples = 0;
+        return false;
+    }
+
+    //only sleep once the silence before this block has covered the whole tail
+    isSleeping = silentSamples >= tailLengthSamples;
+    silentSamples = juce::jmin(silentSamples + numSamples, tailLengthSamples + numSamples);
+
+    return isSleeping;
+}
+
+void SimpleEQAudioProcessor::processChains(juce::dsp::AudioBlock<float>& block)
+{
+    size_t start = 0;
 
+    //while the offline engine's coefficients glide, the chains run one sample per step
+    for (; start < block.getNumSamples() && coefficientRamp.isActive(); ++start)
+    {
+        coefficientRamp.advance();
+        auto sample = block.getSubBlock(start, 1);
+        processChainPair(leftChain, leftFades, rightChain, rightFades, bandEngine, currentStereoMode, sample, fadeScratch.data());
+    }
+
+    if (start < block.getNumSamples())
+    {
+        auto rest = block.getSubBlock(start);
+        processChainPair(leftChain, leftFades, rightChain, rightFades, bandEngine, currentStereoMode, rest, fadeScratch.data());
+    }
+}
+
+void SimpleEQAudioProcessor::processOutgoingChains(juce::dsp::AudioBlock<float>& block)
+{
+    processChainPair(outgoingLeftChain, outgoingLeftFades, outgoingRightChain, outgoingRightFades, outgoingBandEngine,
+                     outgoingStereoMode, block, fadeScratch.data());
+}
+
+void SimpleEQAudioProcessor::processChainsWithDynamicPeak(juce::dsp::AudioBlock<float>& block, const juce::dsp::AudioBlock<float>* key)
+{
+    auto* leftPeak = leftChain.get<ChainPositions::Peak>().coefficients->getRawCoefficients();
+    auto* rightPeak = rightChain.get<ChainPositions::Peak>().coefficients->getRawCoefficients();
+
+    const auto numSamples = (int)block.getNumSamples();
+    float gainInDecibels = publishedDynamicGain;
+
+    //the control intervals run on continuously across blocks, so how the host splits its
+    //buffers never changes where the bell is redesigned
+    for (int start = 0; start < numSamples;)
+    {
+        if (dynamicPeak.isAtControlPoint())
+        {
+            gainInDecibels = dynamicPeak.getGainInDecibels();
+            auto c = dynamicPeak.makeCoefficients(gainInDecibels);
+
+            //in Mid/Side mode the right chain runs the side settings, which have no dynamic mode
+            for (auto* raw : { leftPeak, rightPeak })
+            {
+                if (raw == rightPeak && currentStereoMode == StereoMode::MidSide)
+                    continue;
+
+                raw[0] = c.b0; raw[1] = c.b1; raw[2] = c.b2; raw[3] = c.a1; raw[4] = c.a2;
+            }
+        }
+
+        auto numToProcess = juce::jmin(dynamicPeak.getNumSamplesToControlPoint(), numSamples - start);
+        auto subBlock = block.getSubBlock((size_t)start, (size_t)numToProcess);
+
+        //the detector follows the input (or key) of this interval to design the next one
+        if (key != nullptr)
+        {
+            auto* keyLeft = key->getChannelPointer(0) + start;
+            auto* keyRight = key->getChannelPointer(key->getNumChannels() > 1 ? 1 : 0) + start;
+            dynamicPeak.processEnvelope(keyLeft, keyRight, numToProcess, false);
+        }
+        else
+        {
+            //the block is still L/R here; in the mid/side modes the detector follows Mid and Side as before
+            dynamicPeak.processEnvelope(subBlock.getChannelPointer(0), subBlock.getChannelPointer(1), numToProcess,
+                                        currentStereoMode != StereoMode::LeftRightLinked);
+        }
+
+        processChains(subBlock);
+        start += numToProcess;
+    }
+
+    //let the editor follow the moving bell without republishing for inaudible changes
+    if (std::abs(gainInDecibels - publishedDynamicGain) > 0.1f)
+    {
+        publishedDynamicGain = gainInDecibels;
+        publishCoefficients(false);
+    }
+}
+
+namespace
+{
+    template<typename Function, size_t... Index>
+    void forEachCutFilter(CutFilter& cut, Function&& function, std::index_sequence<Index...>)
+    {
+        (function(cut.get<(int)Index>()), ...);
+    }
+}
+
+void CoefficientRamp::begin(MonoChain& mainChain, MonoChain& sideChain)
+{
+    //a ramp cut short lands where it was heading
+    while (isActive())
+        advance();
+
+    numCaptured = 0;
+    capture(mainChain, Owner::MainPeak);
+    capture(sideChain, Owner::SidePeak);
+}
+
+void CoefficientRamp::capture(MonoChain& chain, Owner peakOwner)
+{
+    auto add = [this](Filter& filter, Owner owner)
+        {
+            auto& glide = glides[(size_t)numCaptured++];
+            glide.raw = filter.coefficients->getRawCoefficients();
+            glide.owner = owner;
+            std::copy(glide.raw, glide.raw + 5, glide.from.begin());
+        };
+
+    forEachCutFilter(chain.get<ChainPositions::LowCut>(), [&](Filter& filter) { add(filter, Owner::Cut); },
+                     std::make_index_sequence<CutDesign::maxStages>());
+    add(chain.get<ChainPositions::Peak>(), peakOwner);
+    forEachCutFilter(chain.get<ChainPositions::HighCut>(), [&](Filter& filter) { add(filter, Owner::Cut); },
+                     std::make_index_sequence<CutDesign::maxStages>());
+}
+
+void CoefficientRamp::start(int numSamples, bool shouldGlideMainPeak, bool shouldGlideSidePeak)
+{
+    numGliding = 0;
+
+    for (int i = 0; i < numCaptured; ++i)
+    {
+        auto glide = glides[(size_t)i];
+        std::copy(glide.raw, glide.raw + 5, glide.to.begin());
+
+        if (glide.to == glide.from
+            || (glide.owner == Owner::MainPeak && !shouldGlideMainPeak)
+            || (glide.owner == Owner::SidePeak && !shouldGlideSidePeak))
+            continue;
+
+        std::copy(glide.from.begin(), glide.from.end(), glide.raw);
+        glides[(size_t)numGliding++] = glide;
+    }
+
+    numCaptured = 0;
+    position = 0;
+    length = numGliding > 0 ? juce::jmax(1, numSamples) : 0;
+}
+
+void CoefficientRamp::advance() noexcept
+{
+    if (!isActive())
+        return;
+
+    ++position;
+    const auto t = (float)position / (float)length;
+
+    for (int i = 0; i < numGliding; ++i)
+    {
+        auto& glide = glides[(size_t)i];
+
+        for (size_t k = 0; k < 5; ++k)
+            glide.raw[k] = position == length ? glide.to[k] : glide.from[k] + t * (glide.to[k] - glide.from[k]);
+    }
+}
+
+SimpleEQAudioProcessor::AnalyzerFifos& SimpleEQAudioProcessor::acquireAnalyzerFifos()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    if (numAnalyzerUsers++ == 0)
+    {
+        analyzerFifosStorage = std::make_unique<AnalyzerFifos>();
+
+        if (analyzerBufferSize > 0)
+        {
+            analyzerFifosStorage->leftChannelFifo.prepare(analyzerBufferSize);
+            analyzerFifosStorage->rightChannelFifo.prepare(analyzerBufferSize);
+            analyzerFifosStorage->keyChannelFifo.prepare(analyzerBufferSize);
+        }
+
+        analyzerFifos.store(analyzerFifosStorage.get());
+    }
+
+    return *analyzerFifosStorage;
+}
+
+void SimpleEQAudioProcessor::releaseAnalyzerFifos()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    jassert(numAnalyzerUsers > 0);
+
+    if (--numAnalyzerUsers == 0)
+    {
+        analyzerFifos.store(nullptr);
+
+        //the audio thread may still be inside the block that loaded the old pointer
+        while (analyzerInUse.load())
+            std::this_thread::yield();
+
+        analyzerFifosStorage.reset();
+    }
+}
+
+SimpleEQAudioProcessor::MemoryFootprint SimpleEQAudioProcessor::getMemoryFootprint() const
+{
+    MemoryFootprint footprint;
+
+    footprint.processor = sizeof(*this);
 
-    juce::dsp::AudioBlock<float> block(buffer);
+    //four chains (two of them for preset crossfades), each holding 17 biquads with a heap-allocated coefficient object and state
+    constexpr size_t numBiquadsPerChain = 2 * CutDesign::maxStages + 1;
+    footprint.filterChains = 4 * numBiquadsPerChain * (sizeof(juce::dsp::IIR::Coefficients<float>) + 8 * sizeof(float));
 
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    footprint.coefficientSnapshots = sizeof(chainCoefficients);
 
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    if (analyzerFifosStorage != nullptr)
+        footprint.analyzerFifos = analyzerFifosStorage->leftChannelFifo.getMemoryUsage()
+                                + analyzerFifosStorage->rightChannelFifo.getMemoryUsage()
+                                + analyzerFifosStorage->keyChannelFifo.getMemoryUsage();
 
-    leftChain.process(leftContext);
-    rightChain.process(rightContext); 
+    if (auto* editor = dynamic_cast<SimpleEQAudioProcessorEditor*>(getActiveEditor()))
+        footprint.editorAnalyzer = editor->getAnalyzerMemoryUsage();
 
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+    return footprint;
+}
+
+juce::String SimpleEQAudioProcessor::MemoryFootprint::toString() const
+{
+    juce::String str;
+    str << "processor: " << (int)processor << " bytes\n"
+        << "filter chains: " << (int)filterChains << " bytes\n"
+        << "coefficient snapshots: " << (int)coefficientSnapshots << " bytes\n"
+        << "analyzer fifos: " << (int)analyzerFifos << " bytes\n"
+        << "editor analyzer: " << (int)editorAnalyzer << " bytes\n"
+        << "total: " << (int)getTotal() << " bytes";
+    return str;
 }
 
 //==============================================================================
@@ -194,7 +1077,7 @@ void SimpleEQAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // as intermediaries to make it easy to save and load complex data.
 
     juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    getPresetValues().writeTo(mos);
 }
 
 void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -202,170 +1085,2094 @@ void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBy
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
     
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
+    PresetValues preset;
+    if (preset.readFrom(data, (size_t)sizeInBytes))
+    {
+        switchToPreset(preset);
+        return;
+    }
+
+    //sessions saved before the binary format hold the whole ValueTree
+    auto tree = juce::ValueTree::readFromData(data, (size_t)sizeInBytes);
     if (tree.isValid())
     {
         apvts.replaceState(tree);
-        updateFilters();
+        // the new settings are picked up by the next processBlock(), which is
+        // the only place (besides prepareToPlay) that touches the chains.
     }
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+PresetValues SimpleEQAudioProcessor::getPresetValues() const
 {
-    ChainSettings settings;
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQ = apvts.getRawParameterValue("Peak Q")->load();
-    settings.lowCutShape = static_cast<Shape>(apvts.getRawParameterValue("LowCut Shape")->load());
-    settings.highCutShape = static_cast<Shape>(apvts.getRawParameterValue("HighCut Shape")->load());
-
-    settings.lowCutBypass = apvts.getRawParameterValue("LowCut Bypass")->load() > 0.5f;
-    settings.highCutBypass = apvts.getRawParameterValue("HighCut Bypass")->load() > 0.5f;
-    settings.peakBypass = apvts.getRawParameterValue("Peak Bypass")->load() > 0.5f;
-    
-    return settings;
+    PresetValues preset;
 
-}
+    for (size_t i = 0; i < presetParameters.size(); ++i)
+        preset.values[i] = presetParameters[i]->convertFrom0to1(presetParameters[i]->getValue());
 
-void /*SimpleEQAudioProcessor::*/updateCoefficients(Coefficients &old, const Coefficients &replacements)
-{
-    *old = *replacements;
+    return preset;
 }
 
-void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings &chainSettings)
+void SimpleEQAudioProcessor::switchToPreset(const PresetValues& preset)
 {
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
+    const juce::ScopedLock sl(presetSwitchLock);
+
+    //not prepared yet: there is nothing to design for, and prepareToPlay() designs from the parameters anyway
+    const auto sampleRate = presetSampleRate.load();
+    if (sampleRate <= 0)
+    {
+        for (size_t i = 0; i < presetParameters.size(); ++i)
+            presetParameters[i]->setValueNotifyingHost(presetParameters[i]->convertTo0to1(preset.values[i]));
+
+        return;
+    }
+
+    //from here until the switch below is published the audio thread ignores the parameters
+    const auto serial = presetSwitchesRequested.fetch_add(1, std::memory_order_acq_rel) + 1;
 
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    //design from exactly what the parameters will hold, so the audio thread finds nothing left to change
+    auto snapped = preset;
+    for (size_t i = 0; i < presetParameters.size(); ++i)
+    {
+        auto* param = presetParameters[i];
+        snapped.values[i] = param->convertFrom0to1(param->convertTo0to1(preset.values[i]));
+    }
 
-    leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypass);
-    rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypass);
+    auto& pending = pendingPresets.getWriteSlot();
+    pending.serial = serial;
+    pending.sampleRate = sampleRate;
+    pending.stereoMode = static_cast<StereoMode>(snapped.get(Parameters::StereoMode));
+    pending.settings = getChainSettings(snapped);
+    pending.sideSettings = pending.stereoMode == StereoMode::MidSide ? getSideChainSettings(snapped) : pending.settings;
+
+    auto design = [this, &pending](CoefficientDesignCache::DesignType type, const ChainSettings& settings)
+        {
+            using DesignType = CoefficientDesignCache::DesignType;
+
+            if (type == DesignType::LowCut)
+                return designCache->getDesign(type, pending.sampleRate, settings.lowCutFreq, 0.f, 0.f, settings.lowCutShape, settings.lowCutFamily);
+            if (type == DesignType::HighCut)
+                return designCache->getDesign(type, pending.sampleRate, settings.highCutFreq, 0.f, 0.f, settings.highCutShape, settings.highCutFamily);
+
+            return designCache->getDesign(type, pending.sampleRate, settings.peakFreq, settings.peakQ, settings.peakGainInDecibels,
+                                          Shape::Shape_12, CutFamily::Butterworth);
+        };
+
+    pending.lowCut = design(CoefficientDesignCache::DesignType::LowCut, pending.settings);
+    pending.peak = design(CoefficientDesignCache::DesignType::Peak, pending.settings);
+    pending.highCut = design(CoefficientDesignCache::DesignType::HighCut, pending.settings);
+    pending.sideLowCut = design(CoefficientDesignCache::DesignType::LowCut, pending.sideSettings);
+    pending.sidePeak = design(CoefficientDesignCache::DesignType::Peak, pending.sideSettings);
+    pending.sideHighCut = design(CoefficientDesignCache::DesignType::HighCut, pending.sideSettings);
+
+    pending.bands.prepare(pending.sampleRate);
+    pending.bands.update(snapped.getBandSettings());
+
+    for (size_t i = 0; i < presetParameters.size(); ++i)
+    {
+        auto* param = presetParameters[i];
+        param->setValueNotifyingHost(param->convertTo0to1(snapped.values[i]));
+    }
 
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutShape);
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutShape);
+    pendingPresets.publish();
 }
 
+void SimpleEQAudioProcessor::startPresetCrossfade(const PresetSwitch& preset)
+{
+    presetSwitchesApplied = preset.serial;
+
+    //designed for another rate (the engine switched meanwhile): just step to it like any other change
+    if (preset.sampleRate != processingSampleRate)
+        return;
+
+    //the current chains keep their state and carry on as the outgoing ones
+    std::swap(leftChain, outgoingLeftChain);
+    std::swap(rightChain, outgoingRightChain);
+    std::swap(leftFades, outgoingLeftFades);
+    std::swap(rightFades, outgoingRightFades);
+    outgoingBandEngine = bandEngine;
+    outgoingStereoMode = currentStereoMode;
+
+    leftChain.reset();
+    rightChain.reset();
+
+    updateCutFilter(leftChain.get<ChainPositions::LowCut>(), preset.lowCut);
+    setCoefficients(leftChain.get<ChainPositions::Peak>(), preset.peak.stages[0]);
+    updateCutFilter(leftChain.get<ChainPositions::HighCut>(), preset.highCut);
+
+    updateCutFilter(rightChain.get<ChainPositions::LowCut>(), preset.sideLowCut);
+    setCoefficients(rightChain.get<ChainPositions::Peak>(), preset.sidePeak.stages[0]);
+    updateCutFilter(rightChain.get<ChainPositions::HighCut>(), preset.sideHighCut);
+
+    //the crossfade covers switching stages in and out, so the new chains start in their final state
+    updateStageActivity(leftChain, leftFades, preset.settings);
+    updateStageActivity(rightChain, rightFades, preset.sideSettings);
+    snapStages(leftChain, leftFades);
+    snapStages(rightChain, rightFades);
+
+    bandEngine = preset.bands;
+
+    filtersNeedUpdate = false;
+    currentSettings = preset.settings;
+    currentSideSettings = preset.sideSettings;
+    currentStereoMode = preset.stereoMode;
+    currentSampleRate = processingSampleRate;
+
+    dynamicPeak.setParameters(preset.settings);
+    if (!preset.settings.peakDynamic)
+        dynamicPeak.reset();
+
+    presetFade.setActive(false);
+    presetFade.snap();
+    presetFade.setActive(true);
+
+    publishCoefficients();
+    updateTailLength();
+}
 
-void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings &chainSettings)
+//'values' is anything with get() and isOn() by Parameters::ID: the live parameters or a PresetValues
+template<typename Values>
+static ChainSettings readChainSettings(const Values& values, const Parameters::ChainIDs& ids)
 {
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
+    ChainSettings settings;
+    settings.lowCutFreq = values.get(ids.lowCutFreq);
+    settings.highCutFreq = values.get(ids.highCutFreq);
+    settings.peakFreq = values.get(ids.peakFreq);
+    settings.peakGainInDecibels = values.get(ids.peakGain);
+    settings.peakQ = values.get(ids.peakQ);
+    settings.lowCutShape = getShape((int)values.get(ids.lowCutShape), (int)values.get(ids.lowCutExtendedSlope));
+    settings.highCutShape = getShape((int)values.get(ids.highCutShape), (int)values.get(ids.highCutExtendedSlope));
+    settings.lowCutFamily = static_cast<CutFamily>(values.get(ids.lowCutType));
+    settings.highCutFamily = static_cast<CutFamily>(values.get(ids.highCutType));
+
+    settings.lowCutBypass = values.isOn(ids.lowCutBypass);
+    settings.highCutBypass = values.isOn(ids.highCutBypass);
+    settings.peakBypass = values.isOn(ids.peakBypass);
+
+    return settings;
+}
 
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
+template<typename Values>
+static ChainSettings readMainChainSettings(const Values& values)
+{
+    auto settings = readChainSettings(values, Parameters::mainChain);
+
+    settings.peakDynamic = values.isOn(Parameters::PeakDynamic);
+    settings.peakThreshold = values.get(Parameters::PeakThreshold);
+    settings.peakRatio = values.get(Parameters::PeakRatio);
+    settings.peakAttackMs = values.get(Parameters::PeakAttack);
+    settings.peakReleaseMs = values.get(Parameters::PeakRelease);
+    settings.peakSidechain = values.isOn(Parameters::PeakSidechain);
+    
+    return settings;
+}
 
-    leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypass);
-    rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypass);
+ChainSettings getSideChainSettings(const Parameters::Values& values)
+{
+    return readChainSettings(values, Parameters::sideChain);
+}
 
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutShape);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutShape);
+ChainSettings getChainSettings(const Parameters::Values& values)
+{
+    return readMainChainSettings(values);
 }
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+ChainSettings getSideChainSettings(const PresetValues& values)
 {
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-        sampleRate,
-        chainSettings.peakFreq,
-        chainSettings.peakQ,
-        juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels)
-    );
+    return readChainSettings(values, Parameters::sideChain);
 }
 
-void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings &chainSettings)
+ChainSettings getChainSettings(const PresetValues& values)
 {
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
+    return readMainChainSettings(values);
+}
 
-    leftChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypass);
-    rightChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypass);
+//==============================================================================
+BandEngine::Settings PresetValues::getBandSettings() const
+{
+    BandEngine::Settings settings;
 
+    for (int i = 0; i < (int)settings.size(); ++i)
+    {
+        auto& band = settings[(size_t)i];
 
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+        band.enabled = getBand(i, Parameters::BandEnable) > 0.5f;
+        band.type = static_cast<BandType>(getBand(i, Parameters::BandType));
+        band.freq = getBand(i, Parameters::BandFreq);
+        band.gainInDecibels = getBand(i, Parameters::BandGain);
+        band.Q = getBand(i, Parameters::BandQ);
+    }
 
+    return settings;
 }
 
-void SimpleEQAudioProcessor::updateFilters()
+//spreads the bands' default frequencies evenly over the log axis
+static float getDefaultBandFrequency(int bandIndex)
 {
-    auto chainSettings = getChainSettings(apvts);
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
-
+    return std::round(juce::mapToLog10((bandIndex + 0.5f) / (float)BandEngine::maxBands, 20.f, 20000.f));
 }
 
-juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::createParameterLayout()
+PresetValues PresetValues::getDefaults()
 {
-    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    PresetValues preset;
 
+    for (size_t i = 0; i < Parameters::table.size(); ++i)
+        preset.values[i] = Parameters::table[i].defaultValue;
 
-    //Freq Parameters
+    for (int i = 0; i < BandEngine::maxBands; ++i)
+        for (int j = 0; j < Parameters::numBandParameters; ++j)
+            preset.values[(size_t)getBandIndex(i, (Parameters::BandID)j)] = j == Parameters::BandFreq ? getDefaultBandFrequency(i)
+                                                                                                     : Parameters::bandParameterTable[(size_t)j].defaultValue;
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-            "LowCut Freq", 
-            "LowCut Freq", 
-            juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 
-            20.f
-        )
-    );
+    return preset;
+}
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-            "HighCut Freq",
-            "HighCut Freq",
-            juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 
-            20000.f
-        )
-    );
+juce::String PresetValues::getID(int index)
+{
+    if (index < Parameters::numParameters)
+        return Parameters::table[(size_t)index].id;
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-            "Peak Freq",
-            "Peak Freq",
-            juce::NormalisableRange<float>(20.f, 20000.f, 1.f,0.25f), 
-            750.f
-        )
-    );
+    const auto bandValue = index - Parameters::numParameters;
+    return SimpleEQAudioProcessor::getBandParameterID(bandValue / Parameters::numBandParameters,
+                                                     Parameters::bandParameterTable[(size_t)(bandValue % Parameters::numBandParameters)].id);
+}
 
+static const std::array<int, PresetValues::numValues>& getPresetValueIDHashes()
+{
+    static const auto hashes = []
+        {
+            std::array<int, PresetValues::numValues> result{};
+            for (int i = 0; i < PresetValues::numValues; ++i)
+                result[(size_t)i] = PresetValues::getID(i).hashCode();
 
-    //Gain Paramaters
+            for (size_t i = 0; i < result.size(); ++i)
+                jassert(std::count(result.begin(), result.end(), result[i]) == 1);   //two IDs share a hash: rename one
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-            "Peak Gain",
-            "Peak Gain",
-            juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f), 
-            0.0f
-        )
-    );
+            return result;
+        }();
 
-    //Q Parameters
-    
-    layout.add(std::make_unique<juce::AudioParameterFloat>(
-            "Peak Q",
-            "Peak Q",
-            juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f), 
-            1.f
-        )
+    return hashes;
+}
+
+static juce::StringArray getChoiceNames(Parameters::Choices choices);
+
+static float clampToParameterRange(int index, float value, float defaultValue)
+{
+    const auto& descriptor = index < Parameters::numParameters ? Parameters::table[(size_t)index]
+                                                               : Parameters::bandParameterTable[(size_t)((index - Parameters::numParameters) % Parameters::numBandParameters)];
+
+    if (! std::isfinite(value))
+        return defaultValue;
+
+    const auto maximum = descriptor.kind == Parameters::Kind::Choice ? (float)(getChoiceNames(descriptor.choices).size() - 1)
+                                                                      : descriptor.maximum;
+
+    return juce::jlimit(descriptor.minimum, maximum, value);
+}
+
+void PresetValues::writeTo(juce::OutputStream& stream) const
+{
+    const auto& hashes = getPresetValueIDHashes();
+
+    stream.write("SEQS", 4);
+    stream.writeShort((short)formatVersion);
+    stream.writeShort((short)numValues);
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        stream.writeInt(hashes[i]);
+        stream.writeFloat(values[i]);
+    }
+}
+
+bool PresetValues::readFrom(const void* data, size_t sizeInBytes)
+{
+    constexpr size_t headerSize = 8, entrySize = sizeof(int) + sizeof(float);
+    if (data == nullptr || sizeInBytes < headerSize || std::memcmp(data, "SEQS", 4) != 0)
+        return false;
+
+    juce::MemoryInputStream stream(data, sizeInBytes, false);
+    stream.skipNextBytes(4);
+
+    const auto version = (juce::uint16)stream.readShort();
+    const auto numStored = (int)(juce::uint16)stream.readShort();
+
+    if (version != formatVersion || sizeInBytes < headerSize + (size_t)numStored * entrySize)
+        return false;
+
+    *this = getDefaults();
+
+    const auto& hashes = getPresetValueIDHashes();
+
+    for (int i = 0; i < numStored; ++i)
+    {
+        const auto hash = stream.readInt();
+        const auto value = stream.readFloat();
+
+        const auto found = std::find(hashes.begin(), hashes.end(), hash);
+        if (found == hashes.end())
+            continue;   //a parameter from a newer build
+
+        const auto index = (int)std::distance(hashes.begin(), found);
+        values[(size_t)index] = clampToParameterRange(index, value, values[(size_t)index]);
+    }
+
+    return true;
+}
+
+bool PresetBank::write(const juce::File& file, const std::vector<Preset>& presets)
+{
+    juce::MemoryOutputStream blobs, names;
+    std::vector<IndexEntry> index(presets.size());
+
+    const auto dataStart = (juce::uint64)(sizeof(Header) + index.size() * sizeof(IndexEntry));
+
+    for (size_t i = 0; i < presets.size(); ++i)
+    {
+        auto& entry = index[i];
+
+        entry.dataOffset = dataStart + blobs.getDataSize();
+        presets[i].values.writeTo(blobs);
+        entry.dataSize = (juce::uint32)(dataStart + blobs.getDataSize() - entry.dataOffset);
+
+        entry.nameOffset = names.getDataSize();   //made absolute below, once the blob size is known
+        entry.nameLength = (juce::uint32)presets[i].name.getNumBytesAsUTF8();
+        names.write(presets[i].name.toRawUTF8(), entry.nameLength);
+    }
+
+    for (auto& entry : index)
+        entry.nameOffset += dataStart + blobs.getDataSize();
+
+    Header header{};
+    std::memcpy(header.magic, "SEQB", 4);
+    header.version = 1;
+    header.numPresets = (juce::uint32)presets.size();
+    header.indexOffset = sizeof(Header);
+
+    file.deleteFile();
+    juce::FileOutputStream out(file);
+    if (!out.openedOk())
+        return false;
+
+    out.write(&header, sizeof(Header));
+    out.write(index.data(), index.size() * sizeof(IndexEntry));
+    out.write(blobs.getData(), blobs.getDataSize());
+    out.write(names.getData(), names.getDataSize());
+    out.flush();
+
+    return out.getStatus().wasOk();
+}
+
+bool PresetBank::open(const juce::File& file)
+{
+    mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    numPresets = 0;
+
+    if (mapping->getData() == nullptr || mapping->getSize() < sizeof(Header))
+        return false;
+
+    Header header;
+    std::memcpy(&header, mapping->getData(), sizeof(Header));
+
+    if (std::memcmp(header.magic, "SEQB", 4) != 0 || header.version != 1)
+        return false;
+
+    //the whole index has to be there; individual entries are checked when they are read
+    if (header.indexOffset + (juce::uint64)header.numPresets * sizeof(IndexEntry) > (juce::uint64)mapping->getSize())
+        return false;
+
+    indexOffset = header.indexOffset;
+    numPresets = (int)header.numPresets;
+    return true;
+}
+
+bool PresetBank::getEntry(int index, IndexEntry& entry) const
+{
+    if (index < 0 || index >= numPresets)
+        return false;
+
+    const auto* data = static_cast<const char*>(mapping->getData());
+    std::memcpy(&entry, data + indexOffset + (size_t)index * sizeof(IndexEntry), sizeof(IndexEntry));
+
+    const auto size = (juce::uint64)mapping->getSize();
+    return entry.dataOffset + entry.dataSize <= size && entry.nameOffset + entry.nameLength <= size;
+}
+
+juce::String PresetBank::getName(int index) const
+{
+    IndexEntry entry;
+    if (!getEntry(index, entry))
+        return {};
+
+    const auto* data = static_cast<const char*>(mapping->getData());
+    return juce::String::fromUTF8(data + entry.nameOffset, (int)entry.nameLength);
+}
+
+bool PresetBank::getPreset(int index, PresetValues& dest) const
+{
+    IndexEntry entry;
+    if (!getEntry(index, entry))
+        return false;
+
+    const auto* data = static_cast<const char*>(mapping->getData());
+    return dest.readFrom(data + entry.dataOffset, entry.dataSize);
+}
+
+void /*SimpleEQAudioProcessor::*/updateCoefficients(Coefficients &old, const Coefficients &replacements)
+{
+    *old = *replacements;
+}
+
+void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings &chainSettings, std::initializer_list<MonoChain*> chains, bool useCache)
+{
+    auto lowCutDesign = designCache->getDesign(CoefficientDesignCache::DesignType::LowCut, processingSampleRate,
+        chainSettings.lowCutFreq, 0.f, 0.f, chainSettings.lowCutShape, chainSettings.lowCutFamily, useCache);
+
+    for (auto* chain : chains)
+        updateCutFilter(chain->get<ChainPositions::LowCut>(), lowCutDesign);
+}
+
+
+void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings &chainSettings, std::initializer_list<MonoChain*> chains, bool useCache)
+{
+    auto highCutDesign = designCache->getDesign(CoefficientDesignCache::DesignType::HighCut, processingSampleRate,
+        chainSettings.highCutFreq, 0.f, 0.f, chainSettings.highCutShape, chainSettings.highCutFamily, useCache);
+
+    for (auto* chain : chains)
+        updateCutFilter(chain->get<ChainPositions::HighCut>(), highCutDesign);
+}
+
+Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(
+        sampleRate,
+        chainSettings.peakFreq,
+        chainSettings.peakQ,
+        juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels)
     );
+}
+
+bool isPeakNeutral(const ChainSettings& chainSettings)
+{
+    //the dynamic bell moves away from its static gain, so it is never skipped
+    return !chainSettings.peakDynamic && std::abs(chainSettings.peakGainInDecibels) < 0.01f;
+}
+
+//the ends of the cut frequency ranges, i.e. the edges of the audible band
+bool isLowCutNeutral(const ChainSettings& chainSettings)
+{
+    return chainSettings.lowCutFreq <= 20.f;
+}
+
+bool isHighCutNeutral(const ChainSettings& chainSettings)
+{
+    return chainSettings.highCutFreq >= 20000.f;
+}
+
+void SimpleEQAudioProcessor::updateStageActivity(MonoChain& chain, StageFades& fades, const ChainSettings& chainSettings)
+{
+    setStageActive<ChainPositions::LowCut>(chain, fades[ChainPositions::LowCut],
+        !chainSettings.lowCutBypass && !isLowCutNeutral(chainSettings));
+    setStageActive<ChainPositions::Peak>(chain, fades[ChainPositions::Peak],
+        !chainSettings.peakBypass && !isPeakNeutral(chainSettings));
+    setStageActive<ChainPositions::HighCut>(chain, fades[ChainPositions::HighCut],
+        !chainSettings.highCutBypass && !isHighCutNeutral(chainSettings));
+}
+
+void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings &chainSettings, std::initializer_list<MonoChain*> chains, bool useCache)
+{
+    auto peakDesign = designCache->getDesign(CoefficientDesignCache::DesignType::Peak, processingSampleRate,
+        chainSettings.peakFreq, chainSettings.peakQ, chainSettings.peakGainInDecibels, Shape::Shape_12, CutFamily::Butterworth, useCache);
+
+    for (auto* chain : chains)
+        setCoefficients(chain->get<ChainPositions::Peak>(), peakDesign.stages[0]);
+}
+
+namespace
+{
+    //frequencies and Q move geometrically, gains linearly; everything discrete jumps straight to 'to'
+    ChainSettings interpolateSettings(const ChainSettings& from, const ChainSettings& to, float position)
+    {
+        auto geometric = [position](float a, float b) { return a > 0.f ? a * std::pow(b / a, position) : b; };
+
+        auto result = to;
+        result.lowCutFreq = geometric(from.lowCutFreq, to.lowCutFreq);
+        result.highCutFreq = geometric(from.highCutFreq, to.highCutFreq);
+        result.peakFreq = geometric(from.peakFreq, to.peakFreq);
+        result.peakQ = geometric(from.peakQ, to.peakQ);
+        result.peakGainInDecibels = from.peakGainInDecibels + (to.peakGainInDecibels - from.peakGainInDecibels) * position;
+        return result;
+    }
+}
+
+bool SimpleEQAudioProcessor::hasContinuousChange(const ChainSettings& from, const ChainSettings& to)
+{
+    return from.lowCutFreq != to.lowCutFreq || from.highCutFreq != to.highCutFreq
+        || from.peakFreq != to.peakFreq || from.peakQ != to.peakQ || from.peakGainInDecibels != to.peakGainInDecibels;
+}
+
+void SimpleEQAudioProcessor::updateFilters(float rampPosition)
+{
+    auto chainSettings = getChainSettings(parameterValues);
+    auto stereoMode = static_cast<StereoMode>(parameterValues.get(Parameters::StereoMode));
+    auto sideSettings = stereoMode == StereoMode::MidSide ? getSideChainSettings(parameterValues) : chainSettings;
+    auto sampleRate = processingSampleRate;
+    const auto isRampStep = rampPosition < 1.f;
+
+    if (isRampStep)
+    {
+        chainSettings = interpolateSettings(rampStartSettings, chainSettings, rampPosition);
+        sideSettings = stereoMode == StereoMode::MidSide ? interpolateSettings(rampStartSideSettings, sideSettings, rampPosition)
+                                                         : chainSettings;
+    }
+
+    //only redesign when something actually changed; the editor is told about every redesign.
+    auto bandsChanged = bandEngine.update(getBandSettings());
+    auto chainChanged = filtersNeedUpdate || chainSettings != currentSettings || sideSettings != currentSideSettings
+                     || stereoMode != currentStereoMode || sampleRate != currentSampleRate;
+
+    if (chainChanged)
+    {
+        filtersNeedUpdate = false;
+        currentSettings = chainSettings;
+        currentSideSettings = sideSettings;
+        currentStereoMode = stereoMode;
+        currentSampleRate = sampleRate;
+
+        dynamicPeak.setParameters(chainSettings);
+        if (!chainSettings.peakDynamic)
+            dynamicPeak.reset();
+
+        //leftChain always runs the main settings (it is what the editor shows);
+        //rightChain only differs in Mid/Side mode, where it carries the side settings
+        if (sideSettings == chainSettings)
+        {
+            updateLowCutFilters(chainSettings, { &leftChain, &rightChain }, !isRampStep);
+            updatePeakFilter(chainSettings, { &leftChain, &rightChain }, !isRampStep);
+            updateHighCutFilters(chainSettings, { &leftChain, &rightChain }, !isRampStep);
+        }
+        else
+        {
+            updateLowCutFilters(chainSettings, { &leftChain }, !isRampStep);
+            updatePeakFilter(chainSettings, { &leftChain }, !isRampStep);
+            updateHighCutFilters(chainSettings, { &leftChain }, !isRampStep);
+
+            updateLowCutFilters(sideSettings, { &rightChain }, !isRampStep);
+            updatePeakFilter(sideSettings, { &rightChain }, !isRampStep);
+            updateHighCutFilters(sideSettings, { &rightChain }, !isRampStep);
+        }
+
+        updateStageActivity(leftChain, leftFades, chainSettings);
+        updateStageActivity(rightChain, rightFades, sideSettings);
+    }
+
+    coefficientsNeedPublishing = coefficientsNeedPublishing || chainChanged || bandsChanged;
+
+    if (coefficientsNeedPublishing && !isRampStep)
+    {
+        coefficientsNeedPublishing = false;
+        publishCoefficients();
+        updateTailLength();
+    }
+}
+
+BandEngine::Settings SimpleEQAudioProcessor::getBandSettings() const
+{
+    BandEngine::Settings settings;
+
+    for (size_t i = 0; i < settings.size(); ++i)
+    {
+        const auto& params = bandParameters[i];
+        auto& band = settings[i];
+
+        band.enabled = params[Parameters::BandEnable]->load() > 0.5f;
+        band.type = static_cast<BandType>(params[Parameters::BandType]->load());
+        band.freq = params[Parameters::BandFreq]->load();
+        band.gainInDecibels = params[Parameters::BandGain]->load();
+        band.Q = params[Parameters::BandQ]->load();
+    }
+
+    return settings;
+}
+
+template<typename CutFilterType, size_t... Index>
+int copyCutFilterCoefficients(const CutFilterType& cut, std::array<BiquadCoefficients, CutDesign::maxStages>& dest,
+                              std::index_sequence<Index...>)
+{
+    int numStages = 0;
+    auto copyStage = [&dest, &numStages](const Filter& stage, bool isBypassed)
+        {
+            if (!isBypassed)
+                dest[(size_t)numStages++] = BiquadCoefficients::fromFilterCoefficients(*stage.coefficients);
+        };
+
+    (copyStage(cut.template get<Index>(), cut.template isBypassed<Index>()), ...);
+
+    return numStages;
+}
+
+template<typename CutFilterType>
+int copyCutFilterCoefficients(const CutFilterType& cut, std::array<BiquadCoefficients, CutDesign::maxStages>& dest)
+{
+    return copyCutFilterCoefficients(cut, dest, std::make_index_sequence<CutDesign::maxStages>());
+}
+
+void SimpleEQAudioProcessor::publishCoefficients(bool shouldUpdateAutoGain)
+{
+    auto& snapshot = chainCoefficients.getWriteSlot();
+
+    snapshot.version = ++coefficientsVersion;
+    snapshot.sampleRate = currentSampleRate;
+
+    //skipped neutral stages are shown as bypassed, since that is what is being run
+    snapshot.lowCutBypass = !leftFades[ChainPositions::LowCut].active;
+    snapshot.peakBypass = !leftFades[ChainPositions::Peak].active;
+    snapshot.highCutBypass = !leftFades[ChainPositions::HighCut].active;
+
+    snapshot.peak = BiquadCoefficients::fromFilterCoefficients(*leftChain.get<ChainPositions::Peak>().coefficients);
+    snapshot.numLowCutStages = copyCutFilterCoefficients(leftChain.get<ChainPositions::LowCut>(), snapshot.lowCut);
+    snapshot.numHighCutStages = copyCutFilterCoefficients(leftChain.get<ChainPositions::HighCut>(), snapshot.highCut);
+
+    snapshot.numBandStages = bandEngine.getNumStages();
+    for (int i = 0; i < snapshot.numBandStages; ++i)
+        snapshot.bandStages[(size_t)i] = bandEngine.getStage(i);
+
+    //the estimate is done on the message thread, from its own copy. a dynamic bell is left out of it,
+    //since compensating for it would undo what it does
+    if (shouldUpdateAutoGain && parameterValues.isOn(Parameters::AutoGain))
+    {
+        auto& autoGainSnapshot = autoGainCoefficients.getWriteSlot();
+        autoGainSnapshot = snapshot;
+        autoGainSnapshot.peakBypass = autoGainSnapshot.peakBypass || currentSettings.peakDynamic;
+        autoGainCoefficients.publish();
+    }
+
+    chainCoefficients.publish();
+}
+
+//==============================================================================
+size_t CoefficientDesignCache::Key::getHash() const
+{
+    auto hash = (juce::uint64)type;
+    for (auto field : { shape, family, sampleRate, frequency, Q, gain })
+        hash = (hash ^ (juce::uint64)(juce::uint32)field) * 0x100000001b3ull;
+
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+CoefficientDesignCache::Key CoefficientDesignCache::makeKey(DesignType type, double sampleRate,
+    float frequency, float Q, float gainInDecibels, Shape shape, CutFamily family)
+{
+    Key key;
+    key.type = type;
+    key.sampleRate = juce::roundToInt(sampleRate);
+    key.frequency = juce::roundToInt(frequency * 100.f);
+
+    if (type == DesignType::Peak)
+    {
+        key.Q = juce::roundToInt(Q * 1000.f);
+        key.gain = juce::roundToInt(gainInDecibels * 100.f);
+    }
+    else
+    {
+        key.shape = shape;
+        key.family = family;
+    }
+
+    return key;
+}
+
+CutDesign CoefficientDesignCache::getDesign(DesignType type, double sampleRate,
+    float frequency, float Q, float gainInDecibels, Shape shape, CutFamily family, bool useCache)
+{
+    const auto key = makeKey(type, sampleRate, frequency, Q, gainInDecibels, shape, family);
+
+    //designed from the quantised key all the same, so it matches what a cache hit would return
+    if (!useCache)
+        return design(key);
+
+    const auto setIndex = (int)(key.getHash() % (size_t)numSets);
+    auto* set = &entries[(size_t)(setIndex * numWays)];
+
+    {
+        const juce::SpinLock::ScopedTryLockType tryLock(lock);
+        if (tryLock.isLocked())
+        {
+            for (int way = 0; way < numWays; ++way)
+            {
+                auto& entry = set[way];
+                if (entry.isUsed && entry.key == key)
+                {
+                    entry.lastUse = ++useCounter;
+                    ++hits;
+                    return entry.design;
+                }
+            }
+        }
+    }
+
+    //design outside the lock, so other instances can keep hitting the cache meanwhile
+    ++misses;
+    auto result = design(key);
+
+    const juce::SpinLock::ScopedTryLockType tryLock(lock);
+    if (tryLock.isLocked())
+    {
+        auto* victim = set;
+        for (int way = 1; way < numWays; ++way)
+            if (set[way].lastUse < victim->lastUse)
+                victim = &set[way];
+
+        if (victim->isUsed)
+            ++evictions;
+
+        victim->key = key;
+        victim->design = result;
+        victim->isUsed = true;
+        victim->lastUse = ++useCounter;
+    }
+
+    return result;
+}
+
+CutDesign CoefficientDesignCache::design(const Key& key)
+{
+    const auto frequency = key.frequency / 100.0;
+    const auto shape = static_cast<Shape>(key.shape);
+    const auto family = static_cast<CutFamily>(key.family);
+
+    switch (key.type)
+    {
+        case DesignType::LowCut:
+            return CutDesign::makeLowCut(family, shape, key.sampleRate, frequency);
+        case DesignType::HighCut:
+            return CutDesign::makeHighCut(family, shape, key.sampleRate, frequency);
+        case DesignType::Peak:
+            break;
+    }
+
+    CutDesign peak;
+    peak.stages[0] = BiquadCoefficients::makePeak(key.sampleRate, frequency, key.Q / 1000.0, key.gain / 100.0);
+    peak.numStages = 1;
+    return peak;
+}
+
+void SimpleEQAudioProcessor::updateTailLength()
+{
+    const auto level = 1.0e-6;   //-120 dB, the same as the silence threshold
+    double tail = 0;
+
+    //a stage still fading out keeps ringing too
+    auto isRunning = [](const StageFade& fade) { return fade.active || fade.isFading(); };
+
+    //a cascade rings for roughly the sum of its stages' decay times
+    for (auto [chain, fades] : { std::make_pair(&leftChain, &leftFades), std::make_pair(&rightChain, &rightFades) })
+    {
+        std::array<BiquadCoefficients, CutDesign::maxStages> cut;
+        double chainTail = 0;
+
+        if (isRunning((*fades)[ChainPositions::LowCut]))
+        {
+            auto numStages = copyCutFilterCoefficients(chain->get<ChainPositions::LowCut>(), cut);
+            for (int i = 0; i < numStages; ++i)
+                chainTail += cut[(size_t)i].getDecayLengthInSamples(level);
+        }
+
+        if (isRunning((*fades)[ChainPositions::HighCut]))
+        {
+            auto numStages = copyCutFilterCoefficients(chain->get<ChainPositions::HighCut>(), cut);
+            for (int i = 0; i < numStages; ++i)
+                chainTail += cut[(size_t)i].getDecayLengthInSamples(level);
+        }
+
+        if (isRunning((*fades)[ChainPositions::Peak]))
+        {
+            auto peak = BiquadCoefficients::fromFilterCoefficients(*chain->get<ChainPositions::Peak>().coefficients);
+            chainTail += peak.getDecayLengthInSamples(level);
+        }
+
+        tail = juce::jmax(tail, chainTail);
+    }
+
+    for (int i = 0; i < bandEngine.getNumStages(); ++i)
+        tail += bandEngine.getStage(i).getDecayLengthInSamples(level);
+
+    //marginally stable designs never fully decay; cap them at ten seconds
+    tail = juce::jmin(tail, currentSampleRate * 10.0);
+
+    //the tail is designed at the processing rate but counted down at the host rate, and the
+    //oversampling filters delay all of it by their latency
+    auto seconds = currentSampleRate > 0 ? tail / currentSampleRate : 0.0;
+    if (getSampleRate() > 0)
+        seconds += getEngineLatency() / getSampleRate();
+    tailLengthSamples = (juce::int64)std::ceil(seconds * getSampleRate());
+    tailLengthSeconds.store(seconds);
+}
+
+double BiquadCoefficients::getDecayLengthInSamples(double level) const
+{
+    //poles are the roots of z^2 + a1 z + a2
+    const auto discriminant = (double)a1 * a1 - 4.0 * a2;
+    double radius;
+
+    if (discriminant < 0)
+    {
+        radius = std::sqrt((double)a2);
+    }
+    else
+    {
+        const auto root = std::sqrt(discriminant);
+        radius = juce::jmax(std::abs(-a1 + root), std::abs(-a1 - root)) * 0.5;
+    }
+
+    if (radius <= 0)
+        return 0;
+
+    if (radius >= 1)
+        return std::numeric_limits<double>::infinity();
+
+    return std::log(level) / std::log(radius);
+}
+
+BiquadCoefficients BiquadCoefficients::fromFilterCoefficients(const juce::dsp::IIR::Coefficients<float>& c)
+{
+    jassert(c.getFilterOrder() == 2);
+    auto* raw = c.getRawCoefficients();
+    return { raw[0], raw[1], raw[2], raw[3], raw[4] };
+}
+
+namespace
+{
+    struct BiquadDesignTerms
+    {
+        double cosW0, alpha;
+    };
+
+    BiquadDesignTerms getDesignTerms(double sampleRate, double frequency, double Q)
+    {
+        //keep the design below Nyquist whatever the sample rate
+        auto w0 = juce::MathConstants<double>::twoPi * juce::jmin(frequency, sampleRate * 0.49) / sampleRate;
+        return { std::cos(w0), std::sin(w0) / (2.0 * Q) };
+    }
+
+    BiquadCoefficients normalise(double b0, double b1, double b2, double a0, double a1, double a2)
+    {
+        auto a0Inv = 1.0 / a0;
+        return { (float)(b0 * a0Inv), (float)(b1 * a0Inv), (float)(b2 * a0Inv), (float)(a1 * a0Inv), (float)(a2 * a0Inv) };
+    }
+}
+
+BiquadCoefficients BiquadCoefficients::makePeak(double sampleRate, double frequency, double Q, double gainInDecibels)
+{
+    auto [c, alpha] = getDesignTerms(sampleRate, frequency, Q);
+    auto A = std::pow(10.0, gainInDecibels / 40.0);
+
+    return normalise(1.0 + alpha * A, -2.0 * c, 1.0 - alpha * A,
+                     1.0 + alpha / A, -2.0 * c, 1.0 - alpha / A);
+}
+
+BiquadCoefficients BiquadCoefficients::makeLowShelf(double sampleRate, double frequency, double Q, double gainInDecibels)
+{
+    auto [c, alpha] = getDesignTerms(sampleRate, frequency, Q);
+    auto A = std::pow(10.0, gainInDecibels / 40.0);
+    auto beta = 2.0 * std::sqrt(A) * alpha;
+
+    return normalise(A * ((A + 1.0) - (A - 1.0) * c + beta),
+                     2.0 * A * ((A - 1.0) - (A + 1.0) * c),
+                     A * ((A + 1.0) - (A - 1.0) * c - beta),
+                     (A + 1.0) + (A - 1.0) * c + beta,
+                     -2.0 * ((A - 1.0) + (A + 1.0) * c),
+                     (A + 1.0) + (A - 1.0) * c - beta);
+}
+
+BiquadCoefficients BiquadCoefficients::makeHighShelf(double sampleRate, double frequency, double Q, double gainInDecibels)
+{
+    auto [c, alpha] = getDesignTerms(sampleRate, frequency, Q);
+    auto A = std::pow(10.0, gainInDecibels / 40.0);
+    auto beta = 2.0 * std::sqrt(A) * alpha;
+
+    return normalise(A * ((A + 1.0) + (A - 1.0) * c + beta),
+                     -2.0 * A * ((A - 1.0) + (A + 1.0) * c),
+                     A * ((A + 1.0) + (A - 1.0) * c - beta),
+                     (A + 1.0) - (A - 1.0) * c + beta,
+                     2.0 * ((A - 1.0) - (A + 1.0) * c),
+                     (A + 1.0) - (A - 1.0) * c - beta);
+}
+
+BiquadCoefficients BiquadCoefficients::makeNotch(double sampleRate, double frequency, double Q)
+{
+    auto [c, alpha] = getDesignTerms(sampleRate, frequency, Q);
+
+    return normalise(1.0, -2.0 * c, 1.0,
+                     1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+BiquadCoefficients BiquadCoefficients::makeLowPass(double sampleRate, double frequency, double Q)
+{
+    auto [c, alpha] = getDesignTerms(sampleRate, frequency, Q);
+
+    return normalise((1.0 - c) * 0.5, 1.0 - c, (1.0 - c) * 0.5,
+                     1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+BiquadCoefficients BiquadCoefficients::makeHighPass(double sampleRate, double frequency, double Q)
+{
+    auto [c, alpha] = getDesignTerms(sampleRate, frequency, Q);
+
+    return normalise((1.0 + c) * 0.5, -(1.0 + c), (1.0 + c) * 0.5,
+                     1.0 + alpha, -2.0 * c, 1.0 - alpha);
+}
+
+//==============================================================================
+namespace
+{
+    using Complex = std::complex<double>;
+
+    //one second-order section of an analog prototype: (n2 s^2 + n1 s + n0) / (s^2 + d1 s + d0)
+    struct AnalogSection
+    {
+        double n2{ 0 }, n1{ 0 }, n0{ 1 }, d1{ 0 }, d0{ 1 };
+    };
+
+    struct AnalogPrototype
+    {
+        std::array<AnalogSection, CutDesign::maxStages> sections;
+        int numSections{ 0 };
+
+        void add(const AnalogSection& section) { sections[(size_t)numSections++] = section; }
+
+        //all-pole section for a pole and its conjugate, unity gain at DC
+        void addPolePair(Complex pole)
+        {
+            AnalogSection section;
+            section.d1 = -2.0 * pole.real();
+            section.d0 = std::norm(pole);
+            section.n0 = section.d0;
+            add(section);
+        }
+    };
+
+    int getOrder(Shape shape)
+    {
+        constexpr std::array<int, 6> orders{ 2, 4, 6, 8, 12, 16 };
+        return orders[(size_t)shape];
+    }
+
+    //'repeats' = 2 squares the response, which is how Linkwitz-Riley is built
+    void addButterworth(AnalogPrototype& prototype, int order, int repeats)
+    {
+        for (int k = 1; k <= order / 2; ++k)
+        {
+            const auto theta = (2 * k - 1) * juce::MathConstants<double>::pi / (2.0 * order);
+            for (int r = 0; r < repeats; ++r)
+                prototype.addPolePair(std::polar(1.0, juce::MathConstants<double>::halfPi + theta));
+        }
+
+        //the real pole of an odd order, squared into one (s + 1)^2 section
+        if (order % 2 == 1)
+        {
+            jassert(repeats == 2);
+            AnalogSection section;
+            section.d1 = 2.0;
+            prototype.add(section);
+        }
+    }
+
+    //roots of the reverse Bessel polynomial (Durand-Kerner), scaled for -3 dB at 1 rad/s
+    void addBessel(AnalogPrototype& prototype, int order)
+    {
+        std::array<double, 17> a{};
+        for (int k = 0; k <= order; ++k)
+        {
+            double c = 1.0;    //(2n - k)! / (2^(n - k) k! (n - k)!)
+            for (int i = order - k + 1; i <= 2 * order - k; ++i) c *= i;
+            for (int i = 1; i <= k; ++i) c /= i;
+            a[(size_t)k] = c / std::pow(2.0, order - k);
+        }
+
+        auto evaluate = [&a, order](Complex s)
+            {
+                Complex result = 0;
+                for (int k = order; k >= 0; --k)
+                    result = result * s + a[(size_t)k] / a[(size_t)order];
+                return result;
+            };
+
+        std::array<Complex, 16> roots;
+        const auto radius = std::pow(a[0] / a[(size_t)order], 1.0 / order);
+        for (int i = 0; i < order; ++i)
+            roots[(size_t)i] = std::polar(radius, juce::MathConstants<double>::twoPi * (i + 0.25) / order + 0.4);
+
+        for (int iteration = 0; iteration < 500; ++iteration)
+            for (int i = 0; i < order; ++i)
+            {
+                Complex denominator = 1;
+                for (int j = 0; j < order; ++j)
+                    if (j != i)
+                        denominator *= roots[(size_t)i] - roots[(size_t)j];
+
+                roots[(size_t)i] -= evaluate(roots[(size_t)i]) / denominator;
+            }
+
+        auto getPowerGain = [&roots, order](double w)
+            {
+                Complex h = 1;
+                for (int i = 0; i < order; ++i)
+                    h *= -roots[(size_t)i] / (Complex(0, w) - roots[(size_t)i]);
+                return std::norm(h);
+            };
+
+        double low = 0.01, high = 100.0;
+        for (int iteration = 0; iteration < 100; ++iteration)
+        {
+            const auto mid = std::sqrt(low * high);
+            (getPowerGain(mid) > 0.5 ? low : high) = mid;
+        }
+
+        for (int i = 0; i < order; ++i)
+            if (roots[(size_t)i].imag() > 0)
+                prototype.addPolePair(roots[(size_t)i] / low);
+    }
+
+    /*
+     Elliptic prototype after Orfanidis, "Lecture Notes on Elliptic Filter Design": Landen
+     transformations for the elliptic functions and the nome series for the degree equation.
+     k is always passed with its complement, which keeps moduli close to 1 accurate.
+     */
+    struct Landen
+    {
+        std::array<double, 16> v{};
+        int size{ 0 };
+
+        Landen(double k, double kc)
+        {
+            while (k > 1.0e-15 && size < (int)v.size())
+            {
+                k /= 1.0 + kc;
+                k *= k;
+                kc = std::sqrt(1.0 - k * k);
+                v[(size_t)size++] = k;
+            }
+        }
+    };
+
+    double getCompleteEllipticIntegral(double k, double kc)
+    {
+        Landen landen(k, kc);
+        auto K = juce::MathConstants<double>::halfPi;
+        for (int i = 0; i < landen.size; ++i)
+            K *= 1.0 + landen.v[(size_t)i];
+        return K;
+    }
+
+    //cd(u K, k)
+    Complex cde(Complex u, double k, double kc)
+    {
+        Landen landen(k, kc);
+        auto w = std::cos(u * juce::MathConstants<double>::halfPi);
+        for (int i = landen.size - 1; i >= 0; --i)
+            w = (1.0 + landen.v[(size_t)i]) * w / (1.0 + landen.v[(size_t)i] * w * w);
+        return w;
+    }
+
+    //inverse of sn(u K, k), in units of K
+    Complex asne(Complex w, double k, double kc)
+    {
+        Landen landen(k, kc);
+        auto previous = k;
+        for (int i = 0; i < landen.size; ++i)
+        {
+            w = w / (1.0 + std::sqrt(1.0 - w * w * previous * previous)) * 2.0 / (1.0 + landen.v[(size_t)i]);
+            previous = landen.v[(size_t)i];
+        }
+        return 1.0 - std::acos(w) / juce::MathConstants<double>::halfPi;
+    }
+
+    double solveDegreeEquation(int order, double k1, double k1c)
+    {
+        const auto q1 = std::exp(-juce::MathConstants<double>::pi * getCompleteEllipticIntegral(k1c, k1)
+                                 / getCompleteEllipticIntegral(k1, k1c));
+        const auto q = std::pow(q1, 1.0 / order);
+
+        double numerator = 0, denominator = 1;
+        for (int m = 0; m < 8; ++m) numerator += std::pow(q, m * (m + 1));
+        for (int m = 1; m < 8; ++m) denominator += 2.0 * std::pow(q, m * m);
+
+        const auto ratio = numerator / denominator;
+        return 4.0 * std::sqrt(q) * ratio * ratio;
+    }
+
+    void addElliptic(AnalogPrototype& prototype, int order, double passbandRippleDb, double stopbandDb)
+    {
+        const auto ep = std::sqrt(std::pow(10.0, passbandRippleDb / 10.0) - 1.0);
+        const auto es = std::sqrt(std::pow(10.0, stopbandDb / 10.0) - 1.0);
+        const auto k1 = ep / es, k1c = std::sqrt(1.0 - k1 * k1);
+        const auto k = solveDegreeEquation(order, k1, k1c), kc = std::sqrt(1.0 - k * k);
+        const auto v0 = Complex(0, -1) * asne(Complex(0, 1) / ep, k1, k1c) / (double)order;
+
+        for (int i = 1; i <= order / 2; ++i)
+        {
+            const auto u = (2.0 * i - 1.0) / order;
+            const auto zero = 1.0 / (k * cde(u, k, kc).real());
+            const auto pole = Complex(0, 1) * cde(u - Complex(0, 1) * v0, k, kc);
+
+            //unity gain at DC per section, then the even-order passband dip on the first one
+            AnalogSection section;
+            section.d1 = -2.0 * pole.real();
+            section.d0 = std::norm(pole);
+
+            auto gain = section.d0 / (zero * zero);
+            if (i == 1)
+                gain /= std::sqrt(1.0 + ep * ep);
+
+            section.n2 = gain;
+            section.n0 = gain * zero * zero;
+            prototype.add(section);
+        }
+    }
+
+    struct PrototypeTable
+    {
+        std::array<std::array<AnalogPrototype, 6>, 4> prototypes;   //[CutFamily][Shape]
+
+        PrototypeTable()
+        {
+            for (int shape = 0; shape < 6; ++shape)
+            {
+                const auto order = getOrder(static_cast<Shape>(shape));
+                addButterworth(prototypes[CutFamily::Butterworth][(size_t)shape], order, 1);
+                addButterworth(prototypes[CutFamily::LinkwitzRiley][(size_t)shape], order / 2, 2);
+                addBessel(prototypes[CutFamily::Bessel][(size_t)shape], order);
+                addElliptic(prototypes[CutFamily::Elliptic][(size_t)shape], order, 0.1, 80.0);
+            }
+        }
+    };
+
+    const AnalogPrototype& getPrototype(CutFamily family, Shape shape)
+    {
+        static const PrototypeTable table;
+        return table.prototypes[(size_t)family][(size_t)shape];
+    }
+
+    //maps a section's s-plane polynomial A s^2 + B s + C through the bilinear transform
+    std::array<double, 3> bilinear(double A, double B, double C)
+    {
+        return { A + B + C, 2.0 * (C - A), A - B + C };
+    }
+
+    CutDesign makeCutDesign(bool isHighPass, CutFamily family, Shape shape, double sampleRate, double frequency)
+    {
+        const auto& prototype = getPrototype(family, shape);
+
+        //prewarped, and kept below Nyquist whatever the sample rate
+        const auto w = std::tan(juce::MathConstants<double>::pi * juce::jmin(frequency, sampleRate * 0.49) / sampleRate);
+
+        CutDesign design;
+        design.numStages = prototype.numSections;
+
+        for (int i = 0; i < prototype.numSections; ++i)
+        {
+            const auto& section = prototype.sections[(size_t)i];
+
+            //lowpass: s -> s / w. Highpass: s -> w / s, then multiplied through by s^2
+            auto numerator = isHighPass ? bilinear(section.n0, section.n1 * w, section.n2 * w * w)
+                                        : bilinear(section.n2 / (w * w), section.n1 / w, section.n0);
+            auto denominator = isHighPass ? bilinear(section.d0, section.d1 * w, w * w)
+                                          : bilinear(1.0 / (w * w), section.d1 / w, section.d0);
+
+            design.stages[(size_t)i] = normalise(numerator[0], numerator[1], numerator[2],
+                                                 denominator[0], denominator[1], denominator[2]);
+        }
 
-    juce::StringArray stringArray;
-    for (int i=0; i<4; ++i){
-        juce::String str;
-        str << (12 + i * 12);
-        str << " db/Oct";
-        stringArray.add(str);
+        return design;
     }
-    
-    layout.add(std::make_unique<juce::AudioParameterChoice>("LowCut Shape", "LowCut Shape", stringArray, 0));
-    layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Shape", "HighCut Shape", stringArray, 0));
+}
+
+CutDesign CutDesign::makeLowCut(CutFamily family, Shape shape, double sampleRate, double frequency)
+{
+    return makeCutDesign(true, family, shape, sampleRate, frequency);
+}
+
+CutDesign CutDesign::makeHighCut(CutFamily family, Shape shape, double sampleRate, double frequency)
+{
+    return makeCutDesign(false, family, shape, sampleRate, frequency);
+}
+
+void CutDesign::prepareTables()
+{
+    getPrototype(CutFamily::Butterworth, Shape::Shape_12);
+}
+//==============================================================================
+namespace
+{
+//plain Nelder-Mead; the fitter's parameters are few and cheap to evaluate, so no gradients are needed
+template<size_t N, typename Function>
+std::array<double, N> minimise(Function&& cost, const std::array<double, N>& start, const std::array<double, N>& step, int maxIterations)
+{
+    using Point = std::array<double, N>;
+
+    std::array<Point, N + 1> simplex;
+    std::array<double, N + 1> costs;
+
+    for (size_t i = 0; i <= N; ++i)
+    {
+        simplex[i] = start;
+        if (i > 0)
+            simplex[i][i - 1] += step[i - 1];
+
+        costs[i] = cost(simplex[i]);
+    }
+
+    auto along = [](const Point& from, const Point& to, double t)
+        {
+            Point p;
+            for (size_t d = 0; d < N; ++d)
+                p[d] = from[d] + t * (to[d] - from[d]);
+            return p;
+        };
+
+    for (int iteration = 0; iteration < maxIterations; ++iteration)
+    {
+        std::array<size_t, N + 1> order;
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&costs](size_t a, size_t b) { return costs[a] < costs[b]; });
+
+        const auto best = order.front(), worst = order.back(), secondWorst = order[N - 1];
+
+        if (costs[worst] - costs[best] < 1.0e-6)
+            break;
+
+        Point centroid{};
+        for (size_t i = 0; i < N; ++i)
+            for (size_t d = 0; d < N; ++d)
+                centroid[d] += simplex[order[i]][d] / (double)N;
+
+        const auto reflected = along(centroid, simplex[worst], -1.0);
+        const auto reflectedCost = cost(reflected);
+
+        if (reflectedCost < costs[best])
+        {
+            const auto expanded = along(centroid, simplex[worst], -2.0);
+            const auto expandedCost = cost(expanded);
+
+            if (expandedCost < reflectedCost)
+            {
+                simplex[worst] = expanded;
+                costs[worst] = expandedCost;
+            }
+            else
+            {
+                simplex[worst] = reflected;
+                costs[worst] = reflectedCost;
+            }
+        }
+        else if (reflectedCost < costs[secondWorst])
+        {
+            simplex[worst] = reflected;
+            costs[worst] = reflectedCost;
+        }
+        else
+        {
+            const auto contracted = along(centroid, simplex[worst], 0.5);
+            const auto contractedCost = cost(contracted);
+
+            if (contractedCost < costs[worst])
+            {
+                simplex[worst] = contracted;
+                costs[worst] = contractedCost;
+            }
+            else
+            {
+                for (size_t i = 0; i <= N; ++i)
+                {
+                    if (i == best)
+                        continue;
+
+                    simplex[i] = along(simplex[best], simplex[i], 0.5);
+                    costs[i] = cost(simplex[i]);
+                }
+            }
+        }
+    }
+
+    return simplex[(size_t)std::distance(costs.begin(), std::min_element(costs.begin(), costs.end()))];
+}
+
+//the fit works in this range, so deep stopbands and deep notches don't dominate the error
+constexpr float fitFloorDecibels = -60.f, fitCeilingDecibels = 30.f;
+}
+
+ResponseFitter::ResponseFitter(std::vector<double> gridFrequencies, double rate) :
+frequencies(std::move(gridFrequencies)),
+sampleRate(rate)
+{
+    cosW.resize(frequencies.size());
+    cos2W.resize(frequencies.size());
+
+    for (size_t i = 0; i < frequencies.size(); ++i)
+    {
+        const auto w = juce::MathConstants<double>::twoPi * frequencies[i] / sampleRate;
+        cosW[i] = std::cos(w);
+        cos2W[i] = std::cos(2.0 * w);
+    }
+}
+
+void ResponseFitter::applyStage(const BiquadCoefficients& stage, std::vector<double>& powerGain) const noexcept
+{
+    //|H|^2 = (B0 + B1 cos w + B2 cos 2w) / (A0 + A1 cos w + A2 cos 2w)
+    const double b0 = stage.b0, b1 = stage.b1, b2 = stage.b2, a1 = stage.a1, a2 = stage.a2;
+
+    const auto B0 = b0 * b0 + b1 * b1 + b2 * b2, B1 = 2.0 * (b0 * b1 + b1 * b2), B2 = 2.0 * b0 * b2;
+    const auto A0 = 1.0 + a1 * a1 + a2 * a2, A1 = 2.0 * (a1 + a1 * a2), A2 = 2.0 * a2;
+
+    const auto numPoints = powerGain.size();
+    const auto* c1 = cosW.data();
+    const auto* c2 = cos2W.data();
+    auto* gain = powerGain.data();
+
+    for (size_t i = 0; i < numPoints; ++i)
+        gain[i] *= (B0 + B1 * c1[i] + B2 * c2[i]) / (A0 + A1 * c1[i] + A2 * c2[i]);
+}
+
+void ResponseFitter::updateCutResponse(bool isLowCut, CutFamily family, Shape shape, float frequency, CutResponse& cut) const
+{
+    if (cut.isValid && cut.family == family && cut.shape == shape && cut.frequency == frequency)
+        return;
+
+    const auto design = isLowCut ? CutDesign::makeLowCut(family, shape, sampleRate, frequency)
+                                 : CutDesign::makeHighCut(family, shape, sampleRate, frequency);
+
+    cut.powerGain.assign(frequencies.size(), 1.0);
+    for (int i = 0; i < design.numStages; ++i)
+        applyStage(design.stages[(size_t)i], cut.powerGain);
+
+    cut.isValid = true;
+    cut.family = family;
+    cut.shape = shape;
+    cut.frequency = frequency;
+}
+
+void ResponseFitter::getResponse(const ChainSettings& settings, std::vector<float>& decibels) const
+{
+    std::vector<double> powerGain;
+    CutResponse lowCut, highCut;
+    getResponse(settings, decibels, powerGain, lowCut, highCut);
+}
+
+void ResponseFitter::getResponse(const ChainSettings& settings, std::vector<float>& decibels, std::vector<double>& powerGain,
+                                 CutResponse& lowCut, CutResponse& highCut) const
+{
+    const auto numPoints = frequencies.size();
+    powerGain.assign(numPoints, 1.0);
+
+    if (!settings.lowCutBypass)
+    {
+        updateCutResponse(true, settings.lowCutFamily, settings.lowCutShape, settings.lowCutFreq, lowCut);
+        for (size_t i = 0; i < numPoints; ++i)
+            powerGain[i] *= lowCut.powerGain[i];
+    }
+
+    if (!settings.highCutBypass)
+    {
+        updateCutResponse(false, settings.highCutFamily, settings.highCutShape, settings.highCutFreq, highCut);
+        for (size_t i = 0; i < numPoints; ++i)
+            powerGain[i] *= highCut.powerGain[i];
+    }
+
+    if (!settings.peakBypass)
+        applyStage(BiquadCoefficients::makePeak(sampleRate, settings.peakFreq, settings.peakQ, settings.peakGainInDecibels), powerGain);
+
+    decibels.resize(numPoints);
+    for (size_t i = 0; i < numPoints; ++i)
+        decibels[i] = juce::jlimit(fitFloorDecibels, fitCeilingDecibels, (float)(10.0 * std::log10(juce::jmax(powerGain[i], 1.0e-30))));
+}
+
+ChainSettings ResponseFitter::fit(const std::vector<float>& wantedDecibels) const
+{
+    jassert(wantedDecibels.size() == frequencies.size());
+
+    const auto numPoints = frequencies.size();
+    if (numPoints == 0)
+        return {};
+
+    std::vector<float> wanted(numPoints);
+    for (size_t i = 0; i < numPoints; ++i)
+        wanted[i] = juce::jlimit(fitFloorDecibels, fitCeilingDecibels, wantedDecibels[i]);
+
+    //the same ranges as the parameters; frequencies and Q are searched on a log scale
+    const auto lowestFrequency = std::log(20.0), highestFrequency = std::log(20000.0);
+
+    //the discrete part of a cut: bypassed, or a family and a shape
+    struct CutChoice
+    {
+        bool isBypassed{ false };
+        CutFamily family{ CutFamily::Butterworth };
+        Shape shape{ Shape_12 };
+    };
+
+    auto toSettings = [&](const std::array<double, 5>& x, const CutChoice& lowCut, const CutChoice& highCut)
+        {
+            ChainSettings settings;
+            settings.lowCutFreq = (float)std::exp(juce::jlimit(lowestFrequency, highestFrequency, x[0]));
+            settings.highCutFreq = (float)std::exp(juce::jlimit(lowestFrequency, highestFrequency, x[1]));
+            settings.peakFreq = (float)std::exp(juce::jlimit(lowestFrequency, highestFrequency, x[2]));
+            settings.peakGainInDecibels = (float)juce::jlimit(-24.0, 24.0, x[3]);
+            settings.peakQ = (float)std::exp(juce::jlimit(std::log(0.1), std::log(10.0), x[4]));
+            settings.lowCutBypass = lowCut.isBypassed;
+            settings.lowCutFamily = lowCut.family;
+            settings.lowCutShape = lowCut.shape;
+            settings.highCutBypass = highCut.isBypassed;
+            settings.highCutFamily = highCut.family;
+            settings.highCutShape = highCut.shape;
+            return settings;
+        };
+
+    std::vector<float> response;
+    std::vector<double> powerGain;
+    CutResponse lowCutResponse, highCutResponse;
+
+    //level-independent error: the variance of the difference
+    auto getError = [&](const ChainSettings& settings)
+        {
+            getResponse(settings, response, powerGain, lowCutResponse, highCutResponse);
+
+            auto sum = 0.0, sumOfSquares = 0.0;
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                const auto difference = (double)(response[i] - wanted[i]);
+                sum += difference;
+                sumOfSquares += difference * difference;
+            }
+
+            const auto mean = sum / (double)numPoints;
+            return sumOfSquares / (double)numPoints - mean * mean;
+        };
+
+    /*
+     Starting points: the cuts where the wanted response first and last comes within 3 dB of its median,
+     with the bell on the largest deviation between them, plus a few flat bells spread over the range
+     so a bell that starts in the wrong place can't get stuck imitating a cut.
+     */
+    auto sorted = wanted;
+    std::nth_element(sorted.begin(), sorted.begin() + (std::ptrdiff_t)numPoints / 2, sorted.end());
+    const auto median = sorted[numPoints / 2];
+
+    size_t passbandStart = 0, passbandEnd = numPoints - 1;
+    while (passbandStart < passbandEnd && wanted[passbandStart] < median - 3.f)
+        ++passbandStart;
+    while (passbandEnd > passbandStart && wanted[passbandEnd] < median - 3.f)
+        --passbandEnd;
+
+    auto largest = passbandStart;
+    for (auto i = passbandStart; i <= passbandEnd; ++i)
+        if (std::abs(wanted[i] - median) > std::abs(wanted[largest] - median))
+            largest = i;
+
+    const auto lowCutStart = passbandStart == 0 ? lowestFrequency : std::log(frequencies[passbandStart]);
+    const auto highCutStart = passbandEnd == numPoints - 1 ? highestFrequency : std::log(frequencies[passbandEnd]);
+
+    std::vector<std::array<double, 5>> starts;
+    starts.push_back({ lowCutStart, highCutStart, std::log(frequencies[largest]), juce::jlimit(-24.0, 24.0, (double)(wanted[largest] - median)), 0.0 });
+
+    for (auto frequency : { 100.0, 1000.0, 10000.0 })
+        starts.push_back({ lowCutStart, highCutStart, std::log(frequency), 0.0, 0.0 });
+
+    const std::array<double, 5> step{ 0.5, -0.5, 1.0, 3.0, 0.5 };
+
+    ChainSettings best;
+    std::array<double, 5> bestX{};
+    CutChoice bestLowCut, bestHighCut;
+    auto bestError = std::numeric_limits<double>::max();
+
+    auto tryChoices = [&](const CutChoice& lowCut, const CutChoice& highCut, const std::array<double, 5>& start)
+        {
+            auto x = minimise([&](const std::array<double, 5>& p) { return getError(toSettings(p, lowCut, highCut)); },
+                              start, step, 400);
+
+            auto settings = toSettings(x, lowCut, highCut);
+            auto error = getError(settings);
+
+            if (error < bestError)
+            {
+                bestError = error;
+                best = settings;
+                bestX = x;
+                bestLowCut = lowCut;
+                bestHighCut = highCut;
+            }
+        };
+
+    //every pair of Butterworth slopes from every starting point...
+    for (int low = Shape_12; low <= Shape_96; ++low)
+        for (int high = Shape_12; high <= Shape_96; ++high)
+            for (const auto& start : starts)
+                tryChoices({ false, CutFamily::Butterworth, static_cast<Shape>(low) },
+                           { false, CutFamily::Butterworth, static_cast<Shape>(high) }, start);
+
+    /*
+     ...then one cut at a time, every other family and slope and bypassing it, starting from the best fit
+     so far. Searching both cuts' options jointly from every start would take some 40 times as long.
+     */
+    std::vector<CutChoice> cutChoices{ { true, CutFamily::Butterworth, Shape_12 } };
+    for (int family = CutFamily::Butterworth; family <= CutFamily::Elliptic; ++family)
+        for (int shape = Shape_12; shape <= Shape_96; ++shape)
+            cutChoices.push_back({ false, static_cast<CutFamily>(family), static_cast<Shape>(shape) });
+
+    auto isSame = [](const CutChoice& a, const CutChoice& b)
+        {
+            return a.isBypassed == b.isBypassed && (a.isBypassed || (a.family == b.family && a.shape == b.shape));
+        };
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const auto errorBefore = bestError;
+
+        for (const auto& choice : cutChoices)
+        {
+            const auto lowCut = bestLowCut, highCut = bestHighCut;
+            if (!isSame(choice, lowCut))
+                tryChoices(choice, highCut, bestX);
+        }
+
+        for (const auto& choice : cutChoices)
+        {
+            const auto lowCut = bestLowCut, highCut = bestHighCut;
+            if (!isSame(choice, highCut))
+                tryChoices(lowCut, choice, bestX);
+        }
+
+        if (bestError >= errorBefore)
+            break;
+    }
+
+    return best;
+}
+
+double BiquadCoefficients::getMagnitudeForFrequency(double frequency, double sampleRate) const
+{
+    const auto w = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    const auto z1 = std::polar(1.0, -w);
+    const auto z2 = z1 * z1;
+
+    auto numerator = (double)b0 + (double)b1 * z1 + (double)b2 * z2;
+    auto denominator = 1.0 + (double)a1 * z1 + (double)a2 * z2;
+
+    return std::abs(numerator / denominator);
+}
+
+double ChainCoefficients::getMagnitudeForFrequency(double frequency) const
+{
+    double mag = 1.0;
+
+    if (!peakBypass)
+        mag *= peak.getMagnitudeForFrequency(frequency, sampleRate);
+
+    if (!lowCutBypass)
+        for (int i = 0; i < numLowCutStages; ++i)
+            mag *= lowCut[(size_t)i].getMagnitudeForFrequency(frequency, sampleRate);
+
+    if (!highCutBypass)
+        for (int i = 0; i < numHighCutStages; ++i)
+            mag *= highCut[(size_t)i].getMagnitudeForFrequency(frequency, sampleRate);
+
+    for (int i = 0; i < numBandStages; ++i)
+        mag *= bandStages[(size_t)i].getMagnitudeForFrequency(frequency, sampleRate);
+
+    return mag;
+}
+//==============================================================================
+void DynamicPeak::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void DynamicPeak::setParameters(const ChainSettings& chainSettings)
+{
+    auto getCoefficient = [this](float timeMs)
+        {
+            return (float)std::exp(-1.0 / (juce::jmax(0.01, (double)timeMs) * 0.001 * sampleRate));
+        };
+
+    attackCoefficient = getCoefficient(chainSettings.peakAttackMs);
+    releaseCoefficient = getCoefficient(chainSettings.peakReleaseMs);
+
+    threshold = chainSettings.peakThreshold;
+    slope = 1.f - 1.f / juce::jmax(1.f, chainSettings.peakRatio);
+    staticGain = chainSettings.peakGainInDecibels;
+
+    auto w0 = juce::MathConstants<double>::twoPi * juce::jmin((double)chainSettings.peakFreq, sampleRate * 0.49) / sampleRate;
+    cosW0 = std::cos(w0);
+    alpha = std::sin(w0) / (2.0 * chainSettings.peakQ);
+}
+
+void DynamicPeak::processEnvelope(const float* left, const float* right, int numSamples, bool followMidSide) noexcept
+{
+    jassert(numSamples <= getNumSamplesToControlPoint());
+
+    auto env = envelope;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        //|M| and |S| are half of |L + R| and |L - R|
+        auto x = followMidSide ? 0.5f * juce::jmax(std::abs(left[i] + right[i]), std::abs(left[i] - right[i]))
+                               : juce::jmax(std::abs(left[i]), std::abs(right[i]));
+        auto coefficient = x > env ? attackCoefficient : releaseCoefficient;
+        env = x + coefficient * (env - x);
+    }
+
+    envelope = env;
+    samplesIntoInterval = (samplesIntoInterval + numSamples) % controlInterval;
+}
+
+float DynamicPeak::getGainInDecibels() const noexcept
+{
+    auto over = juce::Decibels::gainToDecibels(envelope) - threshold;
+    return over > 0.f ? juce::jlimit(-24.f, 24.f, staticGain - over * slope) : staticGain;
+}
+
+BiquadCoefficients DynamicPeak::makeCoefficients(float gainInDecibels) const noexcept
+{
+    //same design as juce::dsp::IIR::Coefficients::makePeakFilter, with only A left to compute
+    auto A = std::exp((double)gainInDecibels * (std::log(10.0) / 40.0));
+    auto a0Inv = 1.0 / (1.0 + alpha / A);
+
+    return { (float)((1.0 + alpha * A) * a0Inv),
+             (float)(-2.0 * cosW0 * a0Inv),
+             (float)((1.0 - alpha * A) * a0Inv),
+             (float)(-2.0 * cosW0 * a0Inv),
+             (float)((1.0 - alpha / A) * a0Inv) };
+}
+//==============================================================================
+void LevelMeter::prepare(double newSampleRate)
+{
+    using namespace juce;
+
+    sampleRate = newSampleRate;
+
+    //4x interpolator: Blackman-windowed sinc over all 48 taps, each phase normalised to unity gain at DC
+    constexpr auto length = truePeakFactor * truePeakTaps;
+    for (int phase = 0; phase < truePeakFactor; ++phase)
+    {
+        auto sum = 0.0;
+        std::array<double, truePeakTaps> taps;
+
+        for (int j = 0; j < truePeakTaps; ++j)
+        {
+            const auto n = j * truePeakFactor + phase;
+            const auto t = (n - (length - 1) * 0.5) / truePeakFactor;
+            const auto sinc = t == 0.0 ? 1.0 : std::sin(MathConstants<double>::pi * t) / (MathConstants<double>::pi * t);
+            const auto w = MathConstants<double>::twoPi * (n + 0.5) / length;
+            taps[(size_t)j] = sinc * (0.42 - 0.5 * std::cos(w) + 0.08 * std::cos(2.0 * w));
+            sum += taps[(size_t)j];
+        }
+
+        for (int j = 0; j < truePeakTaps; ++j)
+            truePeakPhases[(size_t)phase][(size_t)j] = (float)(taps[(size_t)j] / sum);
+    }
+
+    //BS.1770 K-weighting, redesigned for the actual sample rate: a +4 dB high shelf then the RLB high-pass
+    {
+        const auto K = std::tan(MathConstants<double>::pi * 1681.974450955533 / sampleRate);
+        const auto Q = 0.7071752369554196;
+        const auto Vh = std::pow(10.0, 3.999843853973347 / 20.0);
+        const auto Vb = std::pow(Vh, 0.4996667741545416);
+        const auto a0 = 1.0 + K / Q + K * K;
+
+        preFilter.b0 = (float)((Vh + Vb * K / Q + K * K) / a0);
+        preFilter.b1 = (float)(2.0 * (K * K - Vh) / a0);
+        preFilter.b2 = (float)((Vh - Vb * K / Q + K * K) / a0);
+        preFilter.a1 = (float)(2.0 * (K * K - 1.0) / a0);
+        preFilter.a2 = (float)((1.0 - K / Q + K * K) / a0);
+    }
+    {
+        const auto K = std::tan(MathConstants<double>::pi * 38.13547087602444 / sampleRate);
+        const auto Q = 0.5003270373238773;
+        const auto a0 = 1.0 + K / Q + K * K;
+
+        rlbFilter.b0 = 1.f;
+        rlbFilter.b1 = -2.f;
+        rlbFilter.b2 = 1.f;
+        rlbFilter.a1 = (float)(2.0 * (K * K - 1.0) / a0);
+        rlbFilter.a2 = (float)((1.0 - K / Q + K * K) / a0);
+    }
+
+    loudnessBlockLength = jmax(1, roundToInt(sampleRate * 0.1));
+
+    reset();
+}
 
-    layout.add(std::make_unique<juce::AudioParameterBool>("LowCut Bypass", "LowCut Bypass", false));
-    layout.add(std::make_unique<juce::AudioParameterBool>("HighCut Bypass", "HighCut Bypass", false));
-    layout.add(std::make_unique<juce::AudioParameterBool>("Peak Bypass", "Peak Bypass", false));
-    layout.add(std::make_unique<juce::AudioParameterBool>("Analyzer Enable", "Analyzer Enable", true));
+void LevelMeter::reset()
+{
+    for (auto& channel : channels)
+    {
+        channel.history.fill(0.f);
+        channel.writeIndex = 0;
+        channel.preState.fill(0.f);
+        channel.rlbState.fill(0.f);
+        channel.peak = channel.truePeak = channel.meanSquare = 0.f;
+    }
+
+    loudnessBlocks.fill(0.0);
+    nextLoudnessBlock = numLoudnessBlocksFilled = 0;
+    loudnessBlockEnergy = 0.0;
+    samplesIntoLoudnessBlock = 0;
+}
+
+float LevelMeter::processTruePeak(ChannelState& state, const float* samples, int numSamples) noexcept
+{
+    auto maximum = 0.f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        state.history[(size_t)state.writeIndex] = state.history[(size_t)(state.writeIndex + truePeakTaps)] = samples[i];
+
+        if (++state.writeIndex == truePeakTaps)
+            state.writeIndex = 0;
+
+        //newest sample last, so the taps run backwards over it
+        const auto* x = state.history.data() + state.writeIndex;
+
+        for (const auto& phase : truePeakPhases)
+        {
+            auto y = 0.f;
+            for (int j = 0; j < truePeakTaps; ++j)
+                y += phase[(size_t)j] * x[truePeakTaps - 1 - j];
+
+            maximum = juce::jmax(maximum, std::abs(y));
+        }
+    }
+
+    return maximum;
+}
+
+double LevelMeter::processLoudness(ChannelState& state, const float* samples, int numSamples) noexcept
+{
+    auto energy = 0.0;
+    auto& s1 = state.preState;
+    auto& s2 = state.rlbState;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto x = samples[i];
+
+        const auto y1 = preFilter.b0 * x + s1[0];
+        s1[0] = preFilter.b1 * x - preFilter.a1 * y1 + s1[1];
+        s1[1] = preFilter.b2 * x - preFilter.a2 * y1;
+
+        const auto y2 = rlbFilter.b0 * y1 + s2[0];
+        s2[0] = rlbFilter.b1 * y1 - rlbFilter.a1 * y2 + s2[1];
+        s2[1] = rlbFilter.b2 * y1 - rlbFilter.a2 * y2;
+
+        energy += (double)(y2 * y2);
+    }
+
+    return energy;
+}
+
+void LevelMeter::process(const juce::AudioBuffer<float>& buffer) noexcept
+{
+    const auto numSamples = buffer.getNumSamples();
+    const auto numToMeter = juce::jmin(numChannels, buffer.getNumChannels());
+
+    if (numSamples == 0)
+        return;
+
+    //ballistics are applied once per block, scaled by its length
+    const auto rmsCoefficient = 1.f - (float)std::exp(-numSamples / (0.3 * sampleRate));
+    const auto peakFall = (float)juce::Decibels::decibelsToGain(-12.0 * numSamples / sampleRate);
+
+    for (int ch = 0; ch < numToMeter; ++ch)
+    {
+        auto& state = channels[(size_t)ch];
+        const auto* samples = buffer.getReadPointer(ch);
+
+        //four independent accumulators keep the reductions free of loop-carried dependencies
+        std::array<float, 4> maxima{}, squares{};
+        int i = 0;
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                const auto x = samples[i + lane];
+                maxima[(size_t)lane] = juce::jmax(maxima[(size_t)lane], std::abs(x));
+                squares[(size_t)lane] += x * x;
+            }
+        }
+        for (; i < numSamples; ++i)
+        {
+            maxima[0] = juce::jmax(maxima[0], std::abs(samples[i]));
+            squares[0] += samples[i] * samples[i];
+        }
+
+        const auto blockPeak = juce::jmax(maxima[0], maxima[1], maxima[2], maxima[3]);
+        const auto blockMeanSquare = (squares[0] + squares[1] + squares[2] + squares[3]) / (float)numSamples;
+
+        state.peak = juce::jmax(blockPeak, state.peak * peakFall);
+        state.meanSquare += rmsCoefficient * (blockMeanSquare - state.meanSquare);
+        state.truePeak = juce::jmax(processTruePeak(state, samples, numSamples), state.truePeak * peakFall);
+    }
+
+    //loudness blocks span channels, so the block boundaries drive the outer loop
+    for (int start = 0; start < numSamples; )
+    {
+        const auto length = juce::jmin(numSamples - start, loudnessBlockLength - samplesIntoLoudnessBlock);
+
+        for (int ch = 0; ch < numToMeter; ++ch)
+            loudnessBlockEnergy += processLoudness(channels[(size_t)ch], buffer.getReadPointer(ch, start), length);
+
+        start += length;
+        samplesIntoLoudnessBlock += length;
+
+        if (samplesIntoLoudnessBlock == loudnessBlockLength)
+        {
+            loudnessBlocks[(size_t)nextLoudnessBlock] = loudnessBlockEnergy;
+            nextLoudnessBlock = (nextLoudnessBlock + 1) % numLoudnessBlocks;
+            numLoudnessBlocksFilled = juce::jmin(numLoudnessBlocksFilled + 1, numLoudnessBlocks);
+
+            loudnessBlockEnergy = 0.0;
+            samplesIntoLoudnessBlock = 0;
+        }
+    }
+}
+
+float LevelMeter::getLoudness(int numBlocks) const noexcept
+{
+    numBlocks = juce::jmin(numBlocks, numLoudnessBlocksFilled);
+
+    if (numBlocks == 0)
+        return MeterReadings::floor;
+
+    auto energy = 0.0;
+    for (int i = 1; i <= numBlocks; ++i)
+        energy += loudnessBlocks[(size_t)((nextLoudnessBlock - i + numLoudnessBlocks) % numLoudnessBlocks)];
+
+    const auto meanSquare = energy / ((double)numBlocks * loudnessBlockLength);
+
+    if (meanSquare <= 0.0)
+        return MeterReadings::floor;
+
+    return juce::jmax(MeterReadings::floor, (float)(-0.691 + 10.0 * std::log10(meanSquare)));
+}
+
+MeterReadings LevelMeter::getReadings() const noexcept
+{
+    MeterReadings readings;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto& state = channels[(size_t)ch];
+        readings.peak[(size_t)ch] = juce::Decibels::gainToDecibels(state.peak, MeterReadings::floor);
+        readings.rms[(size_t)ch] = juce::Decibels::gainToDecibels(std::sqrt(state.meanSquare), MeterReadings::floor);
+        readings.truePeak[(size_t)ch] = juce::Decibels::gainToDecibels(state.truePeak, MeterReadings::floor);
+    }
+
+    readings.momentaryLoudness = getLoudness(4);
+    readings.shortTermLoudness = getLoudness(numLoudnessBlocks);
+
+    return readings;
+}
+
+//==============================================================================
+void BandEngine::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    needsUpdate = true;
+    bank.reset();
+}
+
+int BandEngine::designBand(const BandSettings& band, BiquadCoefficients* dest) const
+{
+    switch (band.type)
+    {
+        case BandType::Bell:
+            dest[0] = BiquadCoefficients::makePeak(sampleRate, band.freq, band.Q, band.gainInDecibels);
+            return 1;
+        case BandType::LowShelf:
+            dest[0] = BiquadCoefficients::makeLowShelf(sampleRate, band.freq, band.Q, band.gainInDecibels);
+            return 1;
+        case BandType::HighShelf:
+            dest[0] = BiquadCoefficients::makeHighShelf(sampleRate, band.freq, band.Q, band.gainInDecibels);
+            return 1;
+        case BandType::Notch:
+            dest[0] = BiquadCoefficients::makeNotch(sampleRate, band.freq, band.Q);
+            return 1;
+        case BandType::LowCutBand:
+            dest[0] = BiquadCoefficients::makeHighPass(sampleRate, band.freq, band.Q);
+            return 1;
+        case BandType::HighCutBand:
+            dest[0] = BiquadCoefficients::makeLowPass(sampleRate, band.freq, band.Q);
+            return 1;
+        case BandType::Tilt:
+            //pivots around 'freq': half the gain cut below, half boosted above
+            dest[0] = BiquadCoefficients::makeLowShelf(sampleRate, band.freq, band.Q, -0.5 * band.gainInDecibels);
+            dest[1] = BiquadCoefficients::makeHighShelf(sampleRate, band.freq, band.Q, 0.5 * band.gainInDecibels);
+            return 2;
+    }
+
+    return 0;
+}
+
+//gain bands at 0 dB are exact identities whose state is always zero, so dropping them and
+//bringing them back later from cleared state (see copyStateFrom) is seamless
+bool BandEngine::isNeutral(const BandSettings& band)
+{
+    switch (band.type)
+    {
+        case BandType::Bell:
+        case BandType::LowShelf:
+        case BandType::HighShelf:
+        case BandType::Tilt:
+            return std::abs(band.gainInDecibels) < 0.01f;
+        default:
+            return false;
+    }
+}
+
+bool BandEngine::update(const Settings& newSettings)
+{
+    if (!needsUpdate && newSettings == settings)
+        return false;
+
+    needsUpdate = false;
+    settings = newSettings;
+
+    if (sampleRate <= 0)
+    {
+        numStages = 0;
+        bank.setStages(stages.data(), 0);
+        return true;
+    }
+
+    auto previousBank = bank;
+    auto previousSlots = stageSlots;
+    auto previousNumStages = numStages;
+
+    numStages = 0;
+    for (int b = 0; b < maxBands; ++b)
+    {
+        const auto& band = settings[(size_t)b];
+        if (!band.enabled || isNeutral(band))
+            continue;
+
+        auto numBandStages = designBand(band, &stages[(size_t)numStages]);
+        for (int k = 0; k < numBandStages; ++k)
+            stageSlots[(size_t)(numStages + k)] = b * maxStagesPerBand + k;
+
+        numStages += numBandStages;
+    }
+
+    bank.setStages(stages.data(), numStages);
+
+    //bands that stay enabled keep their filter state even if they moved within the bank
+    for (int i = 0; i < numStages; ++i)
+    {
+        int from = -1;
+        for (int j = 0; j < previousNumStages; ++j)
+            if (previousSlots[(size_t)j] == stageSlots[(size_t)i])
+                from = j;
+
+        bank.copyStateFrom(previousBank, from, i);
+    }
+
+    return true;
+}
+
+void BandEngine::process(juce::dsp::AudioBlock<float>& block, int channelMask) noexcept
+{
+    if (numStages == 0)
+        return;
+
+    const auto numChannels = juce::jmin((int)block.getNumChannels(), 2);
+    const auto numSamples = (int)block.getNumSamples();
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        if ((channelMask & (1 << ch)) != 0)
+            bank.process(block.getChannelPointer((size_t)ch), numSamples, ch);
+}
+
+static juce::StringArray getChoiceNames(Parameters::Choices choices)
+{
+    switch (choices)
+    {
+        case Parameters::Choices::Slope:
+            return { "12 db/Oct", "24 db/Oct", "36 db/Oct", "48 db/Oct" };
+        case Parameters::Choices::ExtendedSlope:
+            //in ExtendedSlope order; 60 and 84 dB/oct are skipped
+            return { "Off", "72 db/Oct", "96 db/Oct" };
+        case Parameters::Choices::CutFamily:
+            return { "Butterworth", "Linkwitz-Riley", "Bessel", "Elliptic" };
+        case Parameters::Choices::StereoMode:
+            return { "L/R Linked", "Mid/Side", "Mid Only", "Side Only" };
+        case Parameters::Choices::BandType:
+            return { "Bell", "Low Shelf", "High Shelf", "Notch", "Low Cut", "High Cut", "Tilt" };
+        case Parameters::Choices::None:
+            break;
+    }
+
+    jassertfalse;
+    return {};
+}
+
+void SimpleEQAudioProcessor::addParameter(juce::AudioProcessorValueTreeState::ParameterLayout& layout, const Parameters::Descriptor& descriptor,
+                                          const juce::String& id, float defaultValue)
+{
+    switch (descriptor.kind)
+    {
+        case Parameters::Kind::Float:
+            layout.add(std::make_unique<juce::AudioParameterFloat>(
+                    id,
+                    id,
+                    juce::NormalisableRange<float>(descriptor.minimum, descriptor.maximum, descriptor.interval, descriptor.skew),
+                    defaultValue
+                )
+            );
+            break;
+        case Parameters::Kind::Choice:
+            layout.add(std::make_unique<juce::AudioParameterChoice>(id, id, getChoiceNames(descriptor.choices), (int)defaultValue));
+            break;
+        case Parameters::Kind::Bool:
+            layout.add(std::make_unique<juce::AudioParameterBool>(id, id, defaultValue > 0.5f));
+            break;
+    }
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout SimpleEQAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    for (size_t i = 0; i < Parameters::table.size(); ++i)
+    {
+        if (i == (size_t)Parameters::firstAfterBands)
+            addBandParameters(layout);
+
+        const auto& descriptor = Parameters::table[i];
+        addParameter(layout, descriptor, descriptor.id, descriptor.defaultValue);
+    }
 
     return layout;
 }
 
+juce::String SimpleEQAudioProcessor::getBandParameterID(int bandIndex, const juce::String& name)
+{
+    juce::String str;
+    str << "Band" << (bandIndex + 1) << " " << name;
+    return str;
+}
+
+void SimpleEQAudioProcessor::addBandParameters(juce::AudioProcessorValueTreeState::ParameterLayout& layout)
+{
+    for (int i = 0; i < BandEngine::maxBands; ++i)
+    {
+        auto defaultFreq = getDefaultBandFrequency(i);
+
+        for (size_t j = 0; j < Parameters::bandParameterTable.size(); ++j)
+        {
+            const auto& descriptor = Parameters::bandParameterTable[j];
+            addParameter(layout, descriptor, getBandParameterID(i, descriptor.id), j == (size_t)Parameters::BandFreq ? defaultFreq : descriptor.defaultValue);
+        }
+    }
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
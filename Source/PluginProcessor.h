@@ -10,10 +10,31 @@
 
 #include <JuceHeader.h>
 #include <array>
+#include <thread>
 
-template<typename T>
+#include <atomic>
+
+//bytes a Fifo slot owns on the heap, for the memory-footprint report.
+inline size_t getHeapBytes(const juce::AudioBuffer<float>& b) { return sizeof(float) * (size_t)b.getNumChannels() * (size_t)b.getNumSamples(); }
+inline size_t getHeapBytes(const std::vector<float>& v) { return sizeof(float) * v.capacity(); }
+template<typename T> size_t getHeapBytes(const T&) { return 0; }
+
+/*
+ Single-producer / single-consumer queue of preallocated slots.
+
+ Items can be copied or moved in with push(), or written in place with
+ acquireWrite() / commitWrite() so the producer never touches a temporary.
+ pull() swaps the slot with the caller's object, so as long as the consumer
+ hands back an object of the same shape, no slot ever loses its storage.
+
+ Overflow is counted rather than silently ignored, along with the highest
+ fill level seen since the last resetStatistics().
+ */
+template<typename T, int Capacity = 30>
 struct Fifo
 {
+    static_assert(Capacity > 1, "AbstractFifo keeps one slot free, so Capacity must be at least 2");
+
     void prepare(int numChannels, int numSamples)
     {
         static_assert(std::is_same_v<T, juce::AudioBuffer<float>>,
@@ -27,6 +48,7 @@ struct Fifo
                 true);   //avoid reallocating if you can?
             buffer.clear();
         }
+        resetStatistics();
     }
 
     void prepare(size_t numElements)
@@ -38,26 +60,87 @@ struct Fifo
             buffer.clear();
             buffer.resize(numElements, 0);
         }
+        resetStatistics();
     }
 
     bool push(const T& t)
     {
-        auto write = fifo.write(1);
-        if (write.blockSize1 > 0)
+        if (auto* slot = acquireWrite())
+        {
+            *slot = t;
+            commitWrite();
+            return true;
+        }
+
+        return false;
+    }
+
+    bool push(T&& t)
+    {
+        if (auto* slot = acquireWrite())
         {
-            buffers[write.startIndex1] = t;
+            *slot = std::move(t);
+            commitWrite();
             return true;
         }
 
         return false;
     }
 
+    /**
+     returns the next free slot, or nullptr (and counts a drop) if the fifo is full.
+     The slot belongs to the producer until commitWrite() is called.
+     */
+    T* acquireWrite()
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 > 0)
+            return &buffers[(size_t)start1];
+
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    void commitWrite()
+    {
+        fifo.finishedWrite(1);
+
+        auto ready = fifo.getNumReady();
+        if (ready > highWaterMark.load(std::memory_order_relaxed))
+            highWaterMark.store(ready, std::memory_order_relaxed);
+    }
+
     bool pull(T& t)
     {
-        auto read = fifo.read(1);
-        if (read.blockSize1 > 0)
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+
+        if (size1 > 0)
         {
-            t = buffers[read.startIndex1];
+            using std::swap;
+            swap(t, buffers[(size_t)start1]);
+            fifo.finishedRead(1);
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     hands the oldest item to 'reader' without copying it out of its slot.
+     */
+    template<typename Reader>
+    bool read(Reader&& reader)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+
+        if (size1 > 0)
+        {
+            reader(static_cast<const T&>(buffers[(size_t)start1]));
+            fifo.finishedRead(1);
             return true;
         }
 
@@ -68,16 +151,37 @@ struct Fifo
     {
         return fifo.getNumReady();
     }
+
+    static constexpr int getCapacity() { return Capacity - 1; }
+    int getNumDropped() const { return numDropped.load(std::memory_order_relaxed); }
+    int getHighWaterMark() const { return highWaterMark.load(std::memory_order_relaxed); }
+
+    void resetStatistics()
+    {
+        numDropped.store(0, std::memory_order_relaxed);
+        highWaterMark.store(0, std::memory_order_relaxed);
+    }
+
+    size_t getMemoryUsage() const
+    {
+        size_t bytes = sizeof(*this);
+        for (const auto& buffer : buffers)
+            bytes += getHeapBytes(buffer);
+
+        return bytes;
+    }
 private:
-    static constexpr int Capacity = 30;
     std::array<T, Capacity> buffers;
     juce::AbstractFifo fifo{ Capacity };
+
+    std::atomic<int> numDropped{ 0 }, highWaterMark{ 0 };
+
 };
 
 enum Channel
 {
-    Right, //effectively 0
-    Left //effectively 1
+    Left, //effectively 0 (Mid in the mid/side modes)
+    Right //effectively 1 (Side in the mid/side modes)
 };
 
 template<typename BlockType>
@@ -88,15 +192,52 @@ struct SingleChannelSampleFifo
         prepared.set(false);
     }
 
-    void update(const BlockType& buffer)
+    //with 'isMidSide' the fifo takes Mid (Left) or Side (Right) from an L/R buffer, formed as it copies
+    void update(const BlockType& buffer, bool isMidSide = false)
     {
         jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse);
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
+        jassert(buffer.getNumChannels() > (isMidSide ? 1 : (int)channelToUse));
+        auto* channelPtr = buffer.getReadPointer(isMidSide ? 0 : channelToUse);
+        auto* otherPtr = isMidSide ? buffer.getReadPointer(1) : nullptr;
+        const auto otherSign = channelToUse == Left ? 0.5f : -0.5f;
+
+        const auto numSamples = buffer.getNumSamples();
+        const auto bufferSize = size.get();
 
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        if (bufferSize <= 0)
+            return;
+
+        // samples are copied straight into the slot being filled; if the fifo
+        // is full the whole buffer is dropped (and counted) instead of stalling.
+        for (int i = 0; i < numSamples; )
         {
-            pushNextSampleIntoFifo(channelPtr[i]);
+            if (fifoIndex == 0)
+                slotToFill = audioBufferFifo.acquireWrite();
+
+            auto numToCopy = juce::jmin(numSamples - i, bufferSize - fifoIndex);
+
+            if (slotToFill != nullptr)
+            {
+                auto* dest = slotToFill->getWritePointer(0, fifoIndex);
+
+                if (otherPtr == nullptr)
+                    juce::FloatVectorOperations::copy(dest, channelPtr + i, numToCopy);
+                else
+                    for (int j = 0; j < numToCopy; ++j)
+                        dest[j] = 0.5f * channelPtr[i + j] + otherSign * otherPtr[i + j];
+            }
+
+            fifoIndex += numToCopy;
+            i += numToCopy;
+
+            if (fifoIndex == bufferSize)
+            {
+                if (slotToFill != nullptr)
+                    audioBufferFifo.commitWrite();
+
+                slotToFill = nullptr;
+                fifoIndex = 0;
+            }
         }
     }
 
@@ -105,12 +246,8 @@ struct SingleChannelSampleFifo
         prepared.set(false);
         size.set(bufferSize);
 
-        bufferToFill.setSize(1,             //channel
-            bufferSize,    //num samples
-            false,         //keepExistingContent
-            true,          //clear extra space
-            true);         //avoid reallocating
         audioBufferFifo.prepare(1, bufferSize);
+        slotToFill = nullptr;
         fifoIndex = 0;
         prepared.set(true);
     }
@@ -118,30 +255,30 @@ struct SingleChannelSampleFifo
     int getNumCompleteBuffersAvailable() const { return audioBufferFifo.getNumAvailableForReading(); }
     bool isPrepared() const { return prepared.get(); }
     int getSize() const { return size.get(); }
+    int getNumDroppedBuffers() const { return audioBufferFifo.getNumDropped(); }
+    int getHighWaterMark() const { return audioBufferFifo.getHighWaterMark(); }
+    size_t getMemoryUsage() const { return sizeof(*this) - sizeof(audioBufferFifo) + audioBufferFifo.getMemoryUsage(); }
     //==============================================================================
-    bool getAudioBuffer(BlockType& buf) { return audioBufferFifo.pull(buf); }
+    bool getAudioBuffer(BlockType& buf)
+    {
+        return audioBufferFifo.read([&buf](const BlockType& b) { buf.makeCopyOf(b, true); });
+    }
+
+    /**
+     passes the next complete buffer to 'reader' without copying it out of the fifo.
+     */
+    template<typename Reader>
+    bool readAudioBuffer(Reader&& reader)
+    {
+        return audioBufferFifo.read(std::forward<Reader>(reader));
+    }
 private:
     Channel channelToUse;
     int fifoIndex = 0;
     Fifo<BlockType> audioBufferFifo;
-    BlockType bufferToFill;
+    BlockType* slotToFill = nullptr;
     juce::Atomic<bool> prepared = false;
     juce::Atomic<int> size = 0;
-
-    void pushNextSampleIntoFifo(float sample)
-    {
-        if (fifoIndex == bufferToFill.getNumSamples())
-        {
-            auto ok = audioBufferFifo.push(bufferToFill);
-
-            juce::ignoreUnused(ok);
-
-            fifoIndex = 0;
-        }
-
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
-    }
 };
 
 
@@ -150,7 +287,40 @@ enum Shape
     Shape_12,
     Shape_24,
     Shape_36,
-    Shape_48
+    Shape_48,
+    Shape_72,
+    Shape_96
+};
+
+/*
+ The Shape parameters keep their original four choices, 12 to 48 dB/oct: hosts store choice automation
+ normalised, so a longer list would decode every saved value to a different slope. 72 and 96 dB/oct come
+ from the Extended Slope parameters appended after them, which override the shape unless they are Off.
+ */
+enum ExtendedSlope
+{
+    ExtendedSlope_Off,
+    ExtendedSlope_72,
+    ExtendedSlope_96
+};
+
+constexpr Shape getShape(int slopeChoice, int extendedSlopeChoice)
+{
+    return extendedSlopeChoice == ExtendedSlope_72 ? Shape_72
+         : extendedSlopeChoice == ExtendedSlope_96 ? Shape_96
+         : static_cast<Shape>(slopeChoice < Shape_12 ? Shape_12 : slopeChoice > Shape_48 ? Shape_48 : slopeChoice);
+}
+
+//the two parameter values that select 'shape'
+constexpr int getSlopeChoice(Shape shape) { return shape > Shape_48 ? Shape_48 : shape; }
+constexpr int getExtendedSlopeChoice(Shape shape) { return shape == Shape_72 ? ExtendedSlope_72 : shape == Shape_96 ? ExtendedSlope_96 : ExtendedSlope_Off; }
+
+enum CutFamily
+{
+    Butterworth,
+    LinkwitzRiley,
+    Bessel,
+    Elliptic
 };
 
 struct ChainSettings
@@ -158,14 +328,227 @@ struct ChainSettings
     float peakFreq{ 0 }, peakGainInDecibels{ 0 }, peakQ{ 1.f };
     float lowCutFreq{ 0 }, highCutFreq{ 0 };
     Shape lowCutShape{ Shape::Shape_12 }, highCutShape{ Shape::Shape_12 };
+    CutFamily lowCutFamily{ CutFamily::Butterworth }, highCutFamily{ CutFamily::Butterworth };
 
     bool lowCutBypass{ false }, highCutBypass{ false }, peakBypass{ false };
+
+    //dynamic mode: the peak gain is pulled down by (level - threshold) * (1 - 1/ratio) above the threshold
+    bool peakDynamic{ false };
+    float peakThreshold{ -20.f }, peakRatio{ 2.f }, peakAttackMs{ 10.f }, peakReleaseMs{ 100.f };
+    bool peakSidechain{ false };   //detect on the key input instead of the signal itself
+
+    bool operator==(const ChainSettings& other) const
+    {
+        return peakFreq == other.peakFreq && peakGainInDecibels == other.peakGainInDecibels && peakQ == other.peakQ
+            && lowCutFreq == other.lowCutFreq && highCutFreq == other.highCutFreq
+            && lowCutShape == other.lowCutShape && highCutShape == other.highCutShape
+            && lowCutFamily == other.lowCutFamily && highCutFamily == other.highCutFamily
+            && lowCutBypass == other.lowCutBypass && highCutBypass == other.highCutBypass && peakBypass == other.peakBypass
+            && peakDynamic == other.peakDynamic && peakThreshold == other.peakThreshold && peakRatio == other.peakRatio
+            && peakAttackMs == other.peakAttackMs && peakReleaseMs == other.peakReleaseMs
+            && peakSidechain == other.peakSidechain;
+    }
+    bool operator!=(const ChainSettings& other) const { return !(*this == other); }
 };
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
+/*
+ Every fixed parameter is described once, here. The layout, the cached value pointers, the settings
+ snapshots and the editor attachments are all generated from this table, so the string IDs never
+ appear anywhere else and nothing on the audio thread looks a parameter up by name.
+
+ The table order is the order the host sees, and hosts that address parameters by index keep saved
+ automation and controller mappings by it, so new entries are only ever appended at the end.
+ The per-band parameters come from bandParameterTable, once per band, and sit before firstAfterBands.
+ */
+namespace Parameters
+{
+    enum class Kind { Float, Choice, Bool };
+    enum class Choices { None, Slope, ExtendedSlope, CutFamily, StereoMode, BandType };
+    enum class Control { None, Rotary, Button, ComboBox };   //what the editor binds the parameter to
+
+    struct Descriptor
+    {
+        const char* id;
+        Kind kind;
+        float minimum, maximum, interval, skew;
+        float defaultValue;
+        Choices choices;
+        const char* suffix;   //unit shown by the editor's rotary sliders
+        Control control;
+    };
+
+    constexpr Descriptor makeFloat(const char* id, float minimum, float maximum, float interval, float skew, float defaultValue, const char* suffix)
+    {
+        return { id, Kind::Float, minimum, maximum, interval, skew, defaultValue, Choices::None, suffix, Control::None };
+    }
+
+    constexpr Descriptor makeChoice(const char* id, Choices choices, const char* suffix = "")
+    {
+        return { id, Kind::Choice, 0.f, 0.f, 0.f, 1.f, 0.f, choices, suffix, Control::None };
+    }
+
+    constexpr Descriptor makeBool(const char* id, bool defaultValue)
+    {
+        return { id, Kind::Bool, 0.f, 1.f, 1.f, 1.f, defaultValue ? 1.f : 0.f, Choices::None, "", Control::None };
+    }
+
+    constexpr Descriptor onEditor(Descriptor descriptor, Control control)
+    {
+        descriptor.control = control;
+        return descriptor;
+    }
+
+    enum ID
+    {
+        LowCutFreq, HighCutFreq, PeakFreq, PeakGain, PeakQ,
+        LowCutShape, HighCutShape,
+        LowCutBypass, HighCutBypass, PeakBypass, AnalyzerEnable,
+
+        PeakDynamic, PeakThreshold, PeakRatio, PeakAttack, PeakRelease,
+
+        StereoMode,
+
+        SideLowCutFreq, SideHighCutFreq, SidePeakFreq, SidePeakGain, SidePeakQ,
+        SideLowCutShape, SideHighCutShape,
+        SideLowCutBypass, SideHighCutBypass, SidePeakBypass,
+
+        PeakSidechain,
+
+        LowCutType, HighCutType, SideLowCutType, SideHighCutType,
+
+        AutoGain,
+
+        LowCutExtendedSlope, HighCutExtendedSlope, SideLowCutExtendedSlope, SideHighCutExtendedSlope,
+
+        numParameters
+    };
+
+    inline constexpr std::array<Descriptor, numParameters> table
+    {
+        onEditor(makeFloat("LowCut Freq", 20.f, 20000.f, 1.f, 0.25f, 20.f, "Hz"), Control::Rotary),
+        onEditor(makeFloat("HighCut Freq", 20.f, 20000.f, 1.f, 0.25f, 20000.f, "Hz"), Control::Rotary),
+        onEditor(makeFloat("Peak Freq", 20.f, 20000.f, 1.f, 0.25f, 750.f, "Hz"), Control::Rotary),
+        onEditor(makeFloat("Peak Gain", -24.f, 24.f, 0.5f, 1.f, 0.f, "dB"), Control::Rotary),
+        onEditor(makeFloat("Peak Q", 0.1f, 10.f, 0.05f, 1.f, 1.f, ""), Control::Rotary),
+
+        onEditor(makeChoice("LowCut Shape", Choices::Slope, "dB/Oct"), Control::Rotary),
+        onEditor(makeChoice("HighCut Shape", Choices::Slope, "dB/Oct"), Control::Rotary),
+
+        onEditor(makeBool("LowCut Bypass", false), Control::Button),
+        onEditor(makeBool("HighCut Bypass", false), Control::Button),
+        onEditor(makeBool("Peak Bypass", false), Control::Button),
+        onEditor(makeBool("Analyzer Enable", true), Control::Button),
+
+        //the per-band parameters are laid out here, before firstAfterBands
+
+        makeBool("Peak Dynamic", false),
+        makeFloat("Peak Threshold", -60.f, 0.f, 0.5f, 1.f, -20.f, "dB"),
+        makeFloat("Peak Ratio", 1.f, 20.f, 0.1f, 0.5f, 2.f, ""),
+        makeFloat("Peak Attack", 0.1f, 200.f, 0.1f, 0.4f, 10.f, "ms"),
+        makeFloat("Peak Release", 5.f, 2000.f, 1.f, 0.4f, 100.f, "ms"),
+
+        onEditor(makeChoice("Stereo Mode", Choices::StereoMode), Control::ComboBox),
+
+        //same ranges as the main low cut / peak / high cut parameters
+        makeFloat("Side LowCut Freq", 20.f, 20000.f, 1.f, 0.25f, 20.f, "Hz"),
+        makeFloat("Side HighCut Freq", 20.f, 20000.f, 1.f, 0.25f, 20000.f, "Hz"),
+        makeFloat("Side Peak Freq", 20.f, 20000.f, 1.f, 0.25f, 750.f, "Hz"),
+        makeFloat("Side Peak Gain", -24.f, 24.f, 0.5f, 1.f, 0.f, "dB"),
+        makeFloat("Side Peak Q", 0.1f, 10.f, 0.05f, 1.f, 1.f, ""),
+
+        makeChoice("Side LowCut Shape", Choices::Slope, "dB/Oct"),
+        makeChoice("Side HighCut Shape", Choices::Slope, "dB/Oct"),
+
+        makeBool("Side LowCut Bypass", false),
+        makeBool("Side HighCut Bypass", false),
+        makeBool("Side Peak Bypass", false),
+
+        makeBool("Peak Sidechain", false),
+
+        makeChoice("LowCut Type", Choices::CutFamily),
+        makeChoice("HighCut Type", Choices::CutFamily),
+        makeChoice("Side LowCut Type", Choices::CutFamily),
+        makeChoice("Side HighCut Type", Choices::CutFamily),
+
+        onEditor(makeBool("Auto Gain", false), Control::Button),
+
+        onEditor(makeChoice("LowCut Extended Slope", Choices::ExtendedSlope), Control::ComboBox),
+        onEditor(makeChoice("HighCut Extended Slope", Choices::ExtendedSlope), Control::ComboBox),
+        makeChoice("Side LowCut Extended Slope", Choices::ExtendedSlope),
+        makeChoice("Side HighCut Extended Slope", Choices::ExtendedSlope)
+    };
+
+    constexpr const char* getID(ID id) { return table[(size_t)id].id; }
+
+    //the bands were the first parameters added after the original ones
+    inline constexpr ID firstAfterBands = PeakDynamic;
+
+    //the band parameters are named "Band<n> <name>"; the Freq default is replaced per band
+    enum BandID { BandEnable, BandType, BandFreq, BandGain, BandQ, numBandParameters };
+
+    inline constexpr std::array<Descriptor, numBandParameters> bandParameterTable
+    {
+        makeBool("Enable", false),
+        makeChoice("Type", Choices::BandType),
+        makeFloat("Freq", 20.f, 20000.f, 1.f, 0.25f, 1000.f, "Hz"),
+        makeFloat("Gain", -24.f, 24.f, 0.5f, 1.f, 0.f, "dB"),
+        makeFloat("Q", 0.1f, 10.f, 0.05f, 1.f, 1.f, "")
+    };
+
+    //which table entries make up one low cut / peak / high cut chain
+    struct ChainIDs
+    {
+        ID lowCutFreq, highCutFreq, peakFreq, peakGain, peakQ;
+        ID lowCutShape, highCutShape, lowCutType, highCutType;
+        ID lowCutBypass, highCutBypass, peakBypass;
+        ID lowCutExtendedSlope, highCutExtendedSlope;
+    };
+
+    inline constexpr ChainIDs mainChain{ LowCutFreq, HighCutFreq, PeakFreq, PeakGain, PeakQ,
+                                         LowCutShape, HighCutShape, LowCutType, HighCutType,
+                                         LowCutBypass, HighCutBypass, PeakBypass,
+                                         LowCutExtendedSlope, HighCutExtendedSlope };
+
+    inline constexpr ChainIDs sideChain{ SideLowCutFreq, SideHighCutFreq, SidePeakFreq, SidePeakGain, SidePeakQ,
+                                         SideLowCutShape, SideHighCutShape, SideLowCutType, SideHighCutType,
+                                         SideLowCutBypass, SideHighCutBypass, SidePeakBypass,
+                                         SideLowCutExtendedSlope, SideHighCutExtendedSlope };
+
+    //the raw value of every table entry, looked up by ID once when the processor is built
+    struct Values
+    {
+        void attach(juce::AudioProcessorValueTreeState& apvts)
+        {
+            for (size_t i = 0; i < pointers.size(); ++i)
+            {
+                pointers[i] = apvts.getRawParameterValue(table[i].id);
+                jassert(pointers[i] != nullptr);
+            }
+        }
+
+        float get(ID id) const { return pointers[(size_t)id]->load(std::memory_order_relaxed); }
+        bool isOn(ID id) const { return get(id) > 0.5f; }
+
+    private:
+        std::array<std::atomic<float>*, numParameters> pointers{};
+    };
+}
+
+ChainSettings getChainSettings(const Parameters::Values& values);
+//the second set of low cut / peak / high cut settings, used for the Side channel in Mid/Side mode
+ChainSettings getSideChainSettings(const Parameters::Values& values);
+
+enum StereoMode
+{
+    LeftRightLinked,
+    MidSide,
+    MidOnly,
+    SideOnly
+};
 
 using Filter = juce::dsp::IIR::Filter<float>;
-using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
+//room for the steepest slope (96 dB/oct, 8 biquads); the stages a shape doesn't need stay bypassed
+using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter, Filter, Filter, Filter, Filter>;
 using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
 
 enum ChainPositions
@@ -175,6 +558,40 @@ enum ChainPositions
     HighCut
 };
 
+/*
+ Stages that have no audible effect are skipped entirely: a static bell at 0 dB, or a cut parked
+ at the far end of its range. A 0 dB bell or shelf is an exact identity, so its filter state is
+ always zero and it can be re-engaged from a cleared state without a step.
+ */
+bool isPeakNeutral(const ChainSettings& chainSettings);
+bool isLowCutNeutral(const ChainSettings& chainSettings);
+bool isHighCutNeutral(const ChainSettings& chainSettings);
+
+/*
+ Ramps a MonoChain stage in or out whenever it is switched (bypass, or skipped as neutral), so the
+ cuts' start-up transient and the jump between wet and dry never reach the output.
+ 'position' counts samples from dry (0) to wet (length) and reverses cleanly mid-fade.
+ */
+struct StageFade
+{
+    bool active{ false };
+    int position{ 0 }, length{ 1 };
+
+    void setActive(bool shouldBeActive) { active = shouldBeActive; }
+    void snap() { position = active ? length : 0; }
+
+    bool isFading() const { return position != (active ? length : 0); }
+    int getNumRemaining() const { return active ? length - position : position; }
+
+    float getNextGain() noexcept
+    {
+        position += active ? 1 : -1;
+        return (float)position / (float)length;
+    }
+};
+
+using StageFades = std::array<StageFade, 3>;   //indexed by ChainPositions
+
 
 using Coefficients = Filter::CoefficientsPtr;
 void updateCoefficients(Coefficients& old, const Coefficients& replacements);
@@ -182,58 +599,618 @@ void updateCoefficients(Coefficients& old, const Coefficients& replacements);
 Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
 
 
-template<int Index, typename ChainType, typename CoefficientType>
-void update(ChainType& chain, const CoefficientType& coefficients)
+/*
+ Lock-free "latest value" mailbox for one writer thread and one reader thread.
+ Three slots are rotated so the writer never waits for the reader and the reader
+ always sees a complete value; intermediate values the reader missed are skipped.
+ */
+template<typename T>
+struct TripleBuffer
+{
+    //writer side: fill getWriteSlot(), then publish() it.
+    T& getWriteSlot() { return slots[(size_t)writeIndex]; }
+
+    void publish()
+    {
+        auto previous = middle.exchange(writeIndex | freshBit, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    //reader side: returns true if a newer value was picked up. read() stays valid until the next update().
+    bool update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & freshBit) == 0)
+            return false;
+
+        auto previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    const T& read() const { return slots[(size_t)readIndex]; }
+private:
+    static constexpr int freshBit = 4, indexMask = 3;
+
+    std::array<T, 3> slots;
+    int writeIndex = 0, readIndex = 2;
+    std::atomic<int> middle{ 1 };
+};
+
+struct BiquadCoefficients
+{
+    //normalised so that a0 == 1
+    float b0{ 1.f }, b1{ 0.f }, b2{ 0.f }, a1{ 0.f }, a2{ 0.f };
+
+    static BiquadCoefficients fromFilterCoefficients(const juce::dsp::IIR::Coefficients<float>& c);
+
+    //RBJ cookbook designs. Unlike the juce::dsp::IIR::Coefficients factories these don't allocate.
+    static BiquadCoefficients makePeak(double sampleRate, double frequency, double Q, double gainInDecibels);
+    static BiquadCoefficients makeLowShelf(double sampleRate, double frequency, double Q, double gainInDecibels);
+    static BiquadCoefficients makeHighShelf(double sampleRate, double frequency, double Q, double gainInDecibels);
+    static BiquadCoefficients makeNotch(double sampleRate, double frequency, double Q);
+    static BiquadCoefficients makeLowPass(double sampleRate, double frequency, double Q);
+    static BiquadCoefficients makeHighPass(double sampleRate, double frequency, double Q);
+
+    double getMagnitudeForFrequency(double frequency, double sampleRate) const;
+
+    //samples for the impulse response to decay to 'level', from the largest pole radius
+    double getDecayLengthInSamples(double level) const;
+};
+
+/*
+ A low or high cut as a cascade of up to maxStages biquads.
+ The designs come from analog lowpass prototypes (normalised to a 1 rad/s corner) that are tabulated
+ once per family and slope, then frequency-transformed and bilinear-transformed with prewarping,
+ so designing never allocates. The corner is the -3 dB point for Butterworth and Bessel, -6 dB for
+ Linkwitz-Riley and the 0.1 dB passband edge for Elliptic (80 dB stopband).
+ */
+struct CutDesign
 {
-    updateCoefficients(chain.template get<Index>().coefficients, coefficients[Index]);
-    chain.template setBypassed<Index>(false);
+    static constexpr int maxStages = 8;
+
+    std::array<BiquadCoefficients, maxStages> stages;
+    int numStages{ 0 };
+
+    static CutDesign makeLowCut(CutFamily family, Shape shape, double sampleRate, double frequency);
+    static CutDesign makeHighCut(CutFamily family, Shape shape, double sampleRate, double frequency);
+
+    //builds the prototype tables (Bessel and elliptic need root finding). Call before the audio thread does.
+    static void prepareTables();
+};
+
+//the filters' coefficient objects are created as biquads up front (see prepareCoefficients), so this never allocates
+inline void setCoefficients(Filter& filter, const BiquadCoefficients& c)
+{
+    jassert(filter.coefficients->getFilterOrder() == 2);
+    auto* raw = filter.coefficients->getRawCoefficients();
+    raw[0] = c.b0; raw[1] = c.b1; raw[2] = c.b2; raw[3] = c.a1; raw[4] = c.a2;
 }
 
-template<typename ChainType, typename CoefficientType>
-void updateCutFilter(ChainType& chain, const CoefficientType& coefficients, const Shape& lowCutShape)
+template<int Index, typename ChainType>
+void updateCutStage(ChainType& chain, const CutDesign& design)
+{
+    const auto isUsed = Index < design.numStages;
+    chain.template setBypassed<Index>(!isUsed);
+
+    if (isUsed)
+        setCoefficients(chain.template get<Index>(), design.stages[Index]);
+}
+
+template<typename ChainType, size_t... Index>
+void updateCutStages(ChainType& chain, const CutDesign& design, std::index_sequence<Index...>)
+{
+    (updateCutStage<(int)Index>(chain, design), ...);
+}
+
+template<typename ChainType>
+void updateCutFilter(ChainType& chain, const CutDesign& design)
+{
+    updateCutStages(chain, design, std::make_index_sequence<CutDesign::maxStages>());
+}
+
+/*
+ Per-sample coefficient smoothing for the offline engine. An automation ramp redesigns the filters once
+ per sub-block; across the sub-block, every biquad whose design changed moves its five coefficients
+ linearly from the old design to the new one, one step per sample, and lands on the new one exactly.
+ */
+struct CoefficientRamp
+{
+    //before redesigning: remembers the current designs of both chains
+    void begin(MonoChain& mainChain, MonoChain& sideChain);
+
+    //after redesigning: puts back the old designs of what changed, to glide to the new ones over 'numSamples'.
+    //a peak that the dynamic peak rewrites itself is left on its new design.
+    void start(int numSamples, bool shouldGlideMainPeak, bool shouldGlideSidePeak);
+
+    bool isActive() const { return position < length; }
+    void advance() noexcept;
+
+    //for when the filters are about to be redesigned from scratch
+    void cancel() { numCaptured = numGliding = position = length = 0; }
+
+private:
+    enum class Owner { Cut, MainPeak, SidePeak };
+
+    struct Glide
+    {
+        float* raw{ nullptr };
+        std::array<float, 5> from{}, to{};
+        Owner owner{ Owner::Cut };
+    };
+
+    std::array<Glide, 2 * (2 * CutDesign::maxStages + 1)> glides;   //two chains of two cuts and a peak
+    int numCaptured{ 0 }, numGliding{ 0 };
+    int position{ 0 }, length{ 0 };
+
+    void capture(MonoChain& chain, Owner peakOwner);
+};
+
+/*
+ Cut and peak designs shared by every instance in the process (through a juce::SharedResourcePointer),
+ so a session full of identical low cuts designs each of them only once.
+
+ Keys are quantised, and a miss designs from the quantised values, so a hit returns exactly what a
+ miss would have. The table is a fixed set-associative array that evicts the least recently used
+ entry of a set; designs are returned by value, so nothing handed out can be invalidated by eviction.
+ getDesign() never blocks: if another instance holds the lock, the caller just designs its own copy.
+ */
+struct CoefficientDesignCache
 {
-    chain.template setBypassed<0>(true);
-    chain.template setBypassed<1>(true);
-    chain.template setBypassed<2>(true);
-    chain.template setBypassed<3>(true);
+    enum class DesignType { LowCut, HighCut, Peak };
 
-    switch (lowCutShape) {
+    //shape and family are ignored for the peak, Q and gain for the cuts. A peak is a single stage.
+    //designs that are only used once (the steps of a parameter ramp) pass useCache = false, so they
+    //neither take the lock nor evict designs that will be asked for again.
+    CutDesign getDesign(DesignType type, double sampleRate, float frequency, float Q, float gainInDecibels,
+                        Shape shape, CutFamily family, bool useCache = true);
 
-        case Shape_48:
+    struct Statistics
+    {
+        juce::int64 hits{ 0 }, misses{ 0 }, evictions{ 0 };
+        double getHitRate() const { return hits + misses > 0 ? (double)hits / (double)(hits + misses) : 0.0; }
+    };
+    Statistics getStatistics() const { return { hits.load(), misses.load(), evictions.load() }; }
+private:
+    struct Key
+    {
+        DesignType type{ DesignType::Peak };
+        int shape{ 0 }, family{ 0 };
+        int sampleRate{ 0 };        //Hz
+        int frequency{ 0 };         //1/100 Hz
+        int Q{ 0 };                 //1/1000
+        int gain{ 0 };              //1/100 dB
+
+        bool operator==(const Key& other) const
         {
-            update<3>(chain, coefficients);
+            return type == other.type && shape == other.shape && family == other.family && sampleRate == other.sampleRate
+                && frequency == other.frequency && Q == other.Q && gain == other.gain;
         }
-        case Shape_36:
+        size_t getHash() const;
+    };
+
+    struct Entry
+    {
+        Key key;
+        CutDesign design;
+        bool isUsed{ false };
+        juce::uint32 lastUse{ 0 };
+    };
+
+    static constexpr int numSets = 64, numWays = 4;
+    std::array<Entry, numSets * numWays> entries;
+    juce::uint32 useCounter{ 0 };
+    juce::SpinLock lock;
+
+    std::atomic<juce::int64> hits{ 0 }, misses{ 0 }, evictions{ 0 };
+
+    static Key makeKey(DesignType type, double sampleRate, float frequency, float Q, float gainInDecibels,
+                       Shape shape, CutFamily family);
+    static CutDesign design(const Key& key);
+};
+
+/*
+ Fits the low cut, peak and high cut of a ChainSettings to a wanted response, given in dB on a fixed
+ frequency grid. The model is evaluated at every grid point at once from precomputed cos(w) / cos(2w)
+ tables (|H|^2 of a biquad only needs those). The continuous parameters are found with Nelder-Mead for
+ every pair of Butterworth slopes, then each cut's family, slope and bypass are searched from the best
+ fit. Overall level is ignored, since the chain has no output gain.
+ */
+struct ResponseFitter
+{
+    ResponseFitter(std::vector<double> gridFrequencies, double sampleRate);
+
+    ChainSettings fit(const std::vector<float>& wantedDecibels) const;
+
+    //the model's response in dB at the grid frequencies, clamped to the range the fit works in
+    void getResponse(const ChainSettings& settings, std::vector<float>& decibels) const;
+
+    const std::vector<double>& getFrequencies() const { return frequencies; }
+private:
+    std::vector<double> frequencies;
+    double sampleRate;
+    std::vector<double> cosW, cos2W;
+
+    //a cut's |H|^2 on the grid, kept until its family, shape or frequency changes
+    struct CutResponse
+    {
+        bool isValid{ false };
+        CutFamily family{ CutFamily::Butterworth };
+        Shape shape{ Shape_12 };
+        float frequency{ 0.f };
+        std::vector<double> powerGain;
+    };
+
+    void applyStage(const BiquadCoefficients& stage, std::vector<double>& powerGain) const noexcept;
+    void updateCutResponse(bool isLowCut, CutFamily family, Shape shape, float frequency, CutResponse& cut) const;
+
+    //the fit's version: the buffers are the caller's, so evaluating the cost doesn't allocate
+    void getResponse(const ChainSettings& settings, std::vector<float>& decibels, std::vector<double>& powerGain,
+                     CutResponse& lowCut, CutResponse& highCut) const;
+};
+
+/*
+ A cascade of biquads stored as structure-of-arrays.
+ Only the first getNumStages() entries are processed, so inactive stages cost nothing
+ and the inner loop has no per-stage branches.
+ */
+template<int MaxStages, int MaxChannels = 2>
+struct BiquadBank
+{
+    static constexpr int maxStages = MaxStages;
+
+    void setStages(const BiquadCoefficients* stages, int numStages)
+    {
+        jassert(numStages <= MaxStages);
+        numActive = juce::jmin(numStages, MaxStages);
+
+        for (int i = 0; i < numActive; ++i)
         {
-            update<2>(chain, coefficients);
+            b0[(size_t)i] = stages[i].b0;
+            b1[(size_t)i] = stages[i].b1;
+            b2[(size_t)i] = stages[i].b2;
+            a1[(size_t)i] = stages[i].a1;
+            a2[(size_t)i] = stages[i].a2;
         }
-        case Shape_24:
+    }
+
+    void reset()
+    {
+        for (auto& channel : s1) channel.fill(0.f);
+        for (auto& channel : s2) channel.fill(0.f);
+    }
+
+    //gives stage 'to' the filter state of stage 'from' in 'other', or clears it if from < 0
+    void copyStateFrom(const BiquadBank& other, int from, int to)
+    {
+        for (int ch = 0; ch < MaxChannels; ++ch)
         {
-            update<1>(chain, coefficients);
+            s1[(size_t)ch][(size_t)to] = from < 0 ? 0.f : other.s1[(size_t)ch][(size_t)from];
+            s2[(size_t)ch][(size_t)to] = from < 0 ? 0.f : other.s2[(size_t)ch][(size_t)from];
         }
-        case Shape_12:
+    }
+
+    //transposed direct form II, one stage at a time over the whole block
+    void process(float* samples, int numSamples, int channel) noexcept
+    {
+        auto& z1s = s1[(size_t)channel];
+        auto& z2s = s2[(size_t)channel];
+
+        for (int stage = 0; stage < numActive; ++stage)
         {
-            update<0>(chain, coefficients);
+            const auto cb0 = b0[(size_t)stage], cb1 = b1[(size_t)stage], cb2 = b2[(size_t)stage];
+            const auto ca1 = a1[(size_t)stage], ca2 = a2[(size_t)stage];
+            auto z1 = z1s[(size_t)stage], z2 = z2s[(size_t)stage];
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto x = samples[i];
+                const auto y = cb0 * x + z1;
+                z1 = cb1 * x - ca1 * y + z2;
+                z2 = cb2 * x - ca2 * y;
+                samples[i] = y;
+            }
+
+            z1s[(size_t)stage] = z1;
+            z2s[(size_t)stage] = z2;
         }
+    }
+
+    //the whole cascade for one sample, for loops that do more per sample than filtering
+    float processSample(float x, int channel) noexcept
+    {
+        auto& z1s = s1[(size_t)channel];
+        auto& z2s = s2[(size_t)channel];
+
+        for (int stage = 0; stage < numActive; ++stage)
+        {
+            const auto y = b0[(size_t)stage] * x + z1s[(size_t)stage];
+            z1s[(size_t)stage] = b1[(size_t)stage] * x - a1[(size_t)stage] * y + z2s[(size_t)stage];
+            z2s[(size_t)stage] = b2[(size_t)stage] * x - a2[(size_t)stage] * y;
+            x = y;
+        }
+
+        return x;
+    }
+
+    int getNumStages() const { return numActive; }
+private:
+    std::array<float, MaxStages> b0{}, b1{}, b2{}, a1{}, a2{};
+    std::array<std::array<float, MaxStages>, MaxChannels> s1{}, s2{};
+    int numActive = 0;
+};
+
+enum BandType
+{
+    Bell,
+    LowShelf,
+    HighShelf,
+    Notch,
+    LowCutBand,
+    HighCutBand,
+    Tilt
+};
+
+struct BandSettings
+{
+    bool enabled{ false };
+    BandType type{ BandType::Bell };
+    float freq{ 1000.f }, gainInDecibels{ 0.f }, Q{ 1.f };
+
+    bool operator==(const BandSettings& other) const
+    {
+        return enabled == other.enabled && type == other.type
+            && freq == other.freq && gainInDecibels == other.gainInDecibels && Q == other.Q;
+    }
+    bool operator!=(const BandSettings& other) const { return !(*this == other); }
+};
+
+/*
+ The additional, runtime-configurable bands that run after the fixed low cut / peak / high cut chain.
+ Every enabled band is designed into one or two biquads, which are packed contiguously into a
+ BiquadBank, so CPU scales with the number of enabled bands only.
+ */
+struct BandEngine
+{
+    static constexpr int maxBands = 16;
+    static constexpr int maxStagesPerBand = 2;
+    static constexpr int maxStages = maxBands * maxStagesPerBand;
+
+    using Settings = std::array<BandSettings, maxBands>;
+
+    void prepare(double newSampleRate);
+
+    //returns true if the designs changed
+    bool update(const Settings& newSettings);
+
+    //'channelMask' has a bit for each channel to filter; the others are left untouched
+    void process(juce::dsp::AudioBlock<float>& block, int channelMask = 0b11) noexcept;
+
+    //one channel, or one sample of it for the loops that also do the Mid/Side matrix
+    void process(float* samples, int numSamples, int channel) noexcept { bank.process(samples, numSamples, channel); }
+    float processSample(float sample, int channel) noexcept { return bank.processSample(sample, channel); }
+
+    void reset() { bank.reset(); }
+
+    int getNumStages() const { return numStages; }
+    const BiquadCoefficients& getStage(int index) const { return stages[(size_t)index]; }
+private:
+    double sampleRate{ 0 };
+    Settings settings;
+    bool needsUpdate{ true };
+
+    BiquadBank<maxStages> bank;
+    std::array<BiquadCoefficients, maxStages> stages;
+    std::array<int, maxStages> stageSlots{};   //band * maxStagesPerBand + sub-stage, for carrying filter state across re-packing
+    int numStages{ 0 };
+
+    int designBand(const BandSettings& band, BiquadCoefficients* dest) const;
+    static bool isNeutral(const BandSettings& band);
+};
+
+/*
+ Level-dependent gain for the peak band. The envelope follows the input every sample, while the
+ bell is only redesigned every controlInterval samples, and then only the gain-dependent terms of
+ the RBJ peak design are recomputed (the frequency/Q terms are cached in setParameters()).
+ */
+struct DynamicPeak
+{
+    static constexpr int controlInterval = 32;
+
+    void prepare(double newSampleRate);
+    void reset() { envelope = 0.f; samplesIntoInterval = 0; }
+    void setParameters(const ChainSettings& chainSettings);
+
+    //the bell is redesigned at every control point, from the envelope of the interval before it
+    bool isAtControlPoint() const { return samplesIntoInterval == 0; }
+    int getNumSamplesToControlPoint() const { return controlInterval - samplesIntoInterval; }
+
+    //runs the detector over (at most) the rest of the current control interval, on L/R or on the Mid/Side they make
+    void processEnvelope(const float* left, const float* right, int numSamples, bool followMidSide) noexcept;
+    float getGainInDecibels() const noexcept;
+    BiquadCoefficients makeCoefficients(float gainInDecibels) const noexcept;
+private:
+    double sampleRate{ 44100 };
+    float envelope{ 0.f };
+    int samplesIntoInterval{ 0 };
+    float attackCoefficient{ 0.f }, releaseCoefficient{ 0.f };
+    float threshold{ 0.f }, slope{ 0.f }, staticGain{ 0.f };
+    double cosW0{ 1 }, alpha{ 0 };
+};
+
+//what one metering point shows: levels in dBFS (true peak in dBTP), loudness in LUFS
+struct MeterReadings
+{
+    static constexpr float floor = -100.f;
 
+    std::array<float, 2> peak{ floor, floor }, rms{ floor, floor }, truePeak{ floor, floor };
+    float momentaryLoudness{ floor }, shortTermLoudness{ floor };
+};
+
+struct MeterSnapshot
+{
+    MeterReadings input, output;
+};
+
+/*
+ Level and loudness meter for one point in the signal path, up to two channels.
+ Peak and RMS come from 4-lane block reductions the compiler can vectorise, true peak from a 4x polyphase
+ interpolator, and loudness from BS.1770 K-weighting summed into 100 ms blocks: momentary is the last 4 of
+ them, short-term the last 30. Peaks fall at about 12 dB/s and RMS has a 300 ms time constant.
+ */
+struct LevelMeter
+{
+    static constexpr int numChannels = 2;
+
+    void prepare(double newSampleRate);
+    void reset();
+    void process(const juce::AudioBuffer<float>& buffer) noexcept;
+    MeterReadings getReadings() const noexcept;
+private:
+    static constexpr int truePeakFactor = 4;
+    static constexpr int truePeakTaps = 12;     //per phase
+    static constexpr int numLoudnessBlocks = 30;
+
+    double sampleRate{ 44100 };
+
+    std::array<std::array<float, truePeakTaps>, truePeakFactor> truePeakPhases;
+    BiquadCoefficients preFilter, rlbFilter;    //the two K-weighting stages
+
+    struct ChannelState
+    {
+        std::array<float, 2 * truePeakTaps> history;    //written twice so a window is always contiguous
+        int writeIndex{ 0 };
+
+        std::array<float, 2> preState, rlbState;        //transposed direct form II
+        float peak{ 0.f }, truePeak{ 0.f }, meanSquare{ 0.f };
     };
-}
-inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
+
+    std::array<ChannelState, numChannels> channels;
+
+    //K-weighted energy, summed over channels, of each completed 100 ms block
+    std::array<double, numLoudnessBlocks> loudnessBlocks;
+    int nextLoudnessBlock{ 0 }, numLoudnessBlocksFilled{ 0 };
+    double loudnessBlockEnergy{ 0 };
+    int loudnessBlockLength{ 4410 }, samplesIntoLoudnessBlock{ 0 };
+
+    float processTruePeak(ChannelState& state, const float* samples, int numSamples) noexcept;
+    double processLoudness(ChannelState& state, const float* samples, int numSamples) noexcept;
+    float getLoudness(int numBlocks) const noexcept;
+};
+
+/*
+ Immutable copy of the coefficients the audio thread is currently running.
+ The processor publishes a new one (with a bumped version) only when a design changes.
+ */
+struct ChainCoefficients
 {
-    return  juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
-        sampleRate,
-        2 * (chainSettings.lowCutShape + 1));
-}
-inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
+    juce::uint32 version{ 0 };
+    double sampleRate{ 0 };
+
+    std::array<BiquadCoefficients, CutDesign::maxStages> lowCut, highCut;
+    BiquadCoefficients peak;
+    int numLowCutStages{ 0 }, numHighCutStages{ 0 };
+
+    bool lowCutBypass{ false }, highCutBypass{ false }, peakBypass{ false };
+
+    std::array<BiquadCoefficients, BandEngine::maxStages> bandStages;
+    int numBandStages{ 0 };
+
+    double getMagnitudeForFrequency(double frequency) const;
+};
+
+/*
+ The value of every parameter in plain units: the fixed table first, then each band's parameters in
+ bandParameterTable order. The binary state, the preset bank and switchToPreset() all deal in this.
+ */
+struct PresetValues
 {
-    return  juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq,
-        sampleRate,
-        2 * (chainSettings.highCutShape + 1));
-}
+    static constexpr int numBandValues = BandEngine::maxBands * Parameters::numBandParameters;
+    static constexpr int numValues = Parameters::numParameters + numBandValues;
+
+    std::array<float, numValues> values{};
+
+    float get(Parameters::ID id) const { return values[(size_t)id]; }
+    bool isOn(Parameters::ID id) const { return get(id) > 0.5f; }
+
+    static int getBandIndex(int bandIndex, Parameters::BandID id) { return Parameters::numParameters + bandIndex * Parameters::numBandParameters + id; }
+    float getBand(int bandIndex, Parameters::BandID id) const { return values[(size_t)getBandIndex(bandIndex, id)]; }
+
+    BandEngine::Settings getBandSettings() const;
+
+    static PresetValues getDefaults();
+
+    //the parameter ID of values[index]
+    static juce::String getID(int index);
+
+    /*
+     "SEQS", a 16-bit version and value count, then each value as the hash of its parameter ID followed by
+     the value, both little-endian: under 1 kB. Values are matched by ID rather than position, so a blob
+     stays valid whatever is added or reordered; values it lacks keep their defaults, IDs this build doesn't
+     know are skipped and everything read is clamped to its parameter's range.
+     Version 1 stored the values by position and is no longer read.
+     */
+    static constexpr juce::uint16 formatVersion = 2;
+    void writeTo(juce::OutputStream& stream) const;
+    bool readFrom(const void* data, size_t sizeInBytes);
+};
+
+ChainSettings getChainSettings(const PresetValues& values);
+ChainSettings getSideChainSettings(const PresetValues& values);
+
+/*
+ A file of presets that is memory mapped for reading. A fixed-size index entry per preset gives the offset
+ of its name and its PresetValues blob, so finding any preset is O(1) however many the bank holds, and only
+ the index and the presets actually used are ever paged in.
+
+ Layout: the 24-byte Header, numPresets IndexEntries, then the blobs and the UTF-8 names.
+ */
+struct PresetBank
+{
+    struct Preset
+    {
+        juce::String name;
+        PresetValues values;
+    };
+
+    static bool write(const juce::File& file, const std::vector<Preset>& presets);
+
+    bool open(const juce::File& file);
+
+    int getNumPresets() const { return numPresets; }
+    juce::String getName(int index) const;
+    bool getPreset(int index, PresetValues& dest) const;
+private:
+    struct Header
+    {
+        char magic[4];               //"SEQB"
+        juce::uint32 version;
+        juce::uint32 numPresets;
+        juce::uint32 reserved;
+        juce::uint64 indexOffset;
+    };
+    static_assert(sizeof(Header) == 24, "the bank header is written as is");
+
+    struct IndexEntry
+    {
+        juce::uint64 dataOffset;
+        juce::uint64 nameOffset;
+        juce::uint32 dataSize;
+        juce::uint32 nameLength;
+    };
+    static_assert(sizeof(IndexEntry) == 24, "index entries are written as is");
+
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    int numPresets{ 0 };
+    juce::uint64 indexOffset{ 0 };
+
+    bool getEntry(int index, IndexEntry& entry) const;
+};
+
 //==============================================================================
 /**
 */
-class SimpleEQAudioProcessor  : public juce::AudioProcessor
+class SimpleEQAudioProcessor  : public juce::AudioProcessor,
+                                private juce::Timer
 {
 public:
     //==============================================================================
@@ -277,17 +1254,195 @@ public:
     juce::AudioProcessorValueTreeState apvts{ *this, nullptr,"Parameters", createParameterLayout() };
 
     using BlockType = juce::AudioBuffer<float>;
-    SingleChannelSampleFifo<BlockType> leftChannelFifo{ Channel::Left };
-    SingleChannelSampleFifo<BlockType> rightChannelFifo{ Channel::Right };
+    struct AnalyzerFifos
+    {
+        SingleChannelSampleFifo<BlockType> leftChannelFifo{ Channel::Left };
+        SingleChannelSampleFifo<BlockType> rightChannelFifo{ Channel::Right };
+        SingleChannelSampleFifo<BlockType> keyChannelFifo{ Channel::Left };   //only fed while the sidechain is connected
+    };
+
+    /*
+     The analyzer fifos are only allocated while at least one editor holds them.
+     Both functions must be called from the message thread, acquire/release in pairs.
+     */
+    AnalyzerFifos& acquireAnalyzerFifos();
+    void releaseAnalyzerFifos();
+
+    bool isSidechainConnected() const
+    {
+        auto* bus = getBus(true, 1);
+        return bus != nullptr && bus->isEnabled();
+    }
+
+    TripleBuffer<ChainCoefficients> chainCoefficients;
+
+    //input and output meters, published once per block while metering is on
+    TripleBuffer<MeterSnapshot> meterSnapshots;
+
+    //metering is skipped entirely while this is off
+    void setMeteringEnabled(bool shouldMeter) { meteringEnabled.store(shouldMeter); }
+    bool isMeteringEnabled() const { return meteringEnabled.load(); }
+
+    struct MemoryFootprint
+    {
+        size_t processor{ 0 }, filterChains{ 0 }, coefficientSnapshots{ 0 }, analyzerFifos{ 0 }, editorAnalyzer{ 0 };
+
+        size_t getTotal() const { return processor + filterChains + coefficientSnapshots + analyzerFifos + editorAnalyzer; }
+        juce::String toString() const;
+    };
+
+    //debugging aid: approximate bytes held by each subsystem of this instance. Message thread only.
+    MemoryFootprint getMemoryFootprint() const;
+
+    static juce::String getBandParameterID(int bandIndex, const juce::String& name);
+
+    CoefficientDesignCache::Statistics getDesignCacheStatistics() const { return designCache->getStatistics(); }
+
+    /*
+     Automated cut/peak frequencies, Q and gain are ramped across a block in sub-blocks of at least
+     this many samples, which also bounds the number of redesigns per block. 0 steps once per block.
+     */
+    void setMinimumAutomationSubBlockLength(int numSamples) { minimumSubBlockLength.store(numSamples); }
+
+    //the current value of every parameter, e.g. to store as a preset
+    PresetValues getPresetValues() const;
+
+    /*
+     Moves every parameter to 'preset' without a click. The new filters are designed here, off the audio
+     thread; the audio thread swaps them in and crossfades from the old chains to the new ones over 20 ms.
+     Call from any thread but the audio thread.
+     */
+    void switchToPreset(const PresetValues& preset);
 
 private:
     MonoChain leftChain, rightChain;
+    juce::SharedResourcePointer<CoefficientDesignCache> designCache;
+    BandEngine bandEngine;
+    DynamicPeak dynamicPeak;
+    float publishedDynamicGain{ 0.f };
+
+    StageFades leftFades, rightFades;
+    std::vector<float> fadeScratch;   //dry copy of the samples being crossfaded, one fade length long
+
+    LevelMeter inputMeter, outputMeter;
+    std::atomic<bool> meteringEnabled{ false };
+    bool wasMetering{ false };
+
+    /*
+     Auto gain: when the response changes the audio thread publishes a copy of the coefficients and does
+     nothing else. The message thread polls for it, works out the pink-noise loudness change and posts back
+     the gain that undoes it. The audio thread only ever ramps towards the latest value.
+     */
+    TripleBuffer<ChainCoefficients> autoGainCoefficients;
+    std::atomic<float> autoGainTarget{ 1.f };
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> autoGain{ 1.f };
+    bool wasAutoGain{ false };
+
+    static float getCompensationGain(const ChainCoefficients& coefficients);
+
+    static constexpr int autoGainPollHz = 20;
+    void timerCallback() override;   //picks up the auto gain snapshots
+
+    //offline renders get the high quality engine, chosen in prepareToPlay; the filters then run at processingSampleRate
+    bool isHighQuality{ false };
+    double processingSampleRate{ 44100 };
+    juce::dsp::Oversampling<float> oversampling{ 2, 2, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true, true };
+    juce::dsp::Oversampling<float> keyOversampling{ 2, 2, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true, true };
+
+    void selectEngine(bool shouldUseHighQuality);
+    int getEngineLatency() const;
+
+    std::atomic<int> minimumSubBlockLength{ 64 };
+    static constexpr int highQualitySubBlockLength = 32;   //at the oversampled rate
+    CoefficientRamp coefficientRamp;   //only used by the offline engine
+    ChainSettings rampStartSettings, rampStartSideSettings;
+
+    int getNumAutomationSubBlocks(int numSamples);
+    static bool hasContinuousChange(const ChainSettings& from, const ChainSettings& to);
+    void processSubBlock(juce::AudioBuffer<float>& mainBuffer, juce::AudioBuffer<float>& keyBuffer, bool shouldSleep);
+
+    //the block is L/R on the way in and out, in every stereo mode
+    void processChains(juce::dsp::AudioBlock<float>& block);
+    void updateStageActivity(MonoChain& chain, StageFades& fades, const ChainSettings& chainSettings);
+    void processChainsWithDynamicPeak(juce::dsp::AudioBlock<float>& block, const juce::dsp::AudioBlock<float>* key);
+
+    //looked up once, so reading the settings every block doesn't cost a string lookup per parameter
+    Parameters::Values parameterValues;
+    std::array<std::array<std::atomic<float>*, Parameters::numBandParameters>, BandEngine::maxBands> bandParameters{};
+    BandEngine::Settings getBandSettings() const;
+
+    /*
+     A preset switch, designed by switchToPreset(). Until the audio thread has taken the latest one over
+     (presetSwitchesApplied catches up with presetSwitchesRequested) it leaves the parameters alone,
+     since they may be part-way to the new preset.
+     */
+    struct PresetSwitch
+    {
+        juce::uint32 serial{ 0 };
+        double sampleRate{ 0 };
+        ChainSettings settings, sideSettings;
+        StereoMode stereoMode{ StereoMode::LeftRightLinked };
+        CutDesign lowCut, peak, highCut, sideLowCut, sidePeak, sideHighCut;
+        BandEngine bands;
+    };
+    TripleBuffer<PresetSwitch> pendingPresets;
+    juce::CriticalSection presetSwitchLock;   //only ever taken by switchToPreset() callers
+    std::atomic<juce::uint32> presetSwitchesRequested{ 0 };
+    juce::uint32 presetSwitchesApplied{ 0 };
+    std::atomic<double> presetSampleRate{ 0 };
+    std::vector<juce::RangedAudioParameter*> presetParameters;   //in PresetValues order
+
+    //the chains a preset switch replaced, running on a copy of the input while they are faded out
+    MonoChain outgoingLeftChain, outgoingRightChain;
+    StageFades outgoingLeftFades, outgoingRightFades;
+    BandEngine outgoingBandEngine;
+    StereoMode outgoingStereoMode{ StereoMode::LeftRightLinked };
+    StageFade presetFade;
+    juce::AudioBuffer<float> presetFadeBuffer;
+
+    void startPresetCrossfade(const PresetSwitch& preset);
+    void processOutgoingChains(juce::dsp::AudioBlock<float>& block);
+
+    static void addParameter(juce::AudioProcessorValueTreeState::ParameterLayout& layout, const Parameters::Descriptor& descriptor,
+                             const juce::String& id, float defaultValue);
+    static void addBandParameters(juce::AudioProcessorValueTreeState::ParameterLayout& layout);
+
+    ChainSettings currentSettings, currentSideSettings;
+    StereoMode currentStereoMode{ StereoMode::LeftRightLinked };
+    double currentSampleRate{ 0 };
+    bool filtersNeedUpdate{ true };
+    juce::uint32 coefficientsVersion{ 0 };
+
+    //dynamic peak movements pass false: auto gain follows the settings, not the detector
+    void publishCoefficients(bool shouldUpdateAutoGain = true);
+
+    /*
+     Once the input has been silent for longer than the filters take to ring out, processBlock()
+     just outputs silence; the filters restart from cleared state when the signal comes back.
+     The tail is recomputed from the designs whenever they change.
+     */
+    std::atomic<double> tailLengthSeconds{ 0.0 };
+    juce::int64 tailLengthSamples{ 0 }, silentSamples{ 0 };
+    bool isSleeping{ false };
+
+    void updateTailLength();
+    bool updateSilenceState(const juce::AudioBuffer<float>& input);
+
+    std::unique_ptr<AnalyzerFifos> analyzerFifosStorage;
+    std::atomic<AnalyzerFifos*> analyzerFifos{ nullptr };
+    std::atomic<bool> analyzerInUse{ false };
+    int numAnalyzerUsers{ 0 };
+    int analyzerBufferSize{ 0 };
 
-    void updatePeakFilter(const ChainSettings& chainSettings);
-    void updateLowCutFilters(const ChainSettings& chainSettings);
-    void updateHighCutFilters(const ChainSettings& chainSettings);
+    void updatePeakFilter(const ChainSettings& chainSettings, std::initializer_list<MonoChain*> chains, bool useCache = true);
+    void updateLowCutFilters(const ChainSettings& chainSettings, std::initializer_list<MonoChain*> chains, bool useCache = true);
+    void updateHighCutFilters(const ChainSettings& chainSettings, std::initializer_list<MonoChain*> chains, bool useCache = true);
 
-    void updateFilters();
+    //rampPosition < 1 moves the continuous parameters that far from rampStartSettings towards their current values.
+    //the steps of a ramp are neither published nor cached: the editor, auto gain and the tail length only
+    //hear about the block's final design.
+    void updateFilters(float rampPosition = 1.f);
+    bool coefficientsNeedPublishing{ false };
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleEQAudioProcessor)
 };
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    The dynamic peak redesigns its bell once per control interval. Those
+    intervals run on across processBlock() calls, so the output must not
+    depend on how the host splits its buffers.
+
+  ==============================================================================
+*/
+
+#include "TestRendering.h"
+
+namespace
+{
+    //a 1 kHz tone stepping between quiet and loud, so the detector keeps crossing the threshold
+    juce::AudioBuffer<float> makeBursts(double sampleRate, int numSamples)
+    {
+        juce::AudioBuffer<float> buffer(2, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto level = (i / 2000) % 2 == 0 ? 0.05f : 0.8f;
+            const auto phase = juce::MathConstants<double>::twoPi * 1000.0 * i / sampleRate;
+            buffer.setSample(0, i, level * (float)std::sin(phase));
+            buffer.setSample(1, i, level * (float)std::sin(phase + 0.3));
+        }
+
+        return buffer;
+    }
+
+    bool isIdentical(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+            if (std::memcmp(a.getReadPointer(ch), b.getReadPointer(ch), sizeof(float) * (size_t)a.getNumSamples()) != 0)
+                return false;
+
+        return true;
+    }
+}
+
+struct DynamicPeakTests : juce::UnitTest
+{
+    DynamicPeakTests() : juce::UnitTest("Dynamic peak", "SimpleEQ") {}
+
+    void runTest() override
+    {
+        const TestRendering::ParameterValues dynamicPeak
+        {
+            { Parameters::getID(Parameters::PeakFreq), 1000.f }, { Parameters::getID(Parameters::PeakGain), 9.f },
+            { Parameters::getID(Parameters::PeakQ), 1.f }, { Parameters::getID(Parameters::PeakDynamic), 1.f },
+            { Parameters::getID(Parameters::PeakThreshold), -30.f }, { Parameters::getID(Parameters::PeakRatio), 8.f },
+            { Parameters::getID(Parameters::PeakAttack), 1.f }, { Parameters::getID(Parameters::PeakRelease), 20.f }
+        };
+
+        for (auto isOffline : { false, true })
+        {
+            constexpr double sampleRate = 48000.0;
+            constexpr int numSamples = 16000;
+            const auto input = makeBursts(sampleRate, numSamples);
+
+            const auto whole = TestRendering::render(dynamicPeak, sampleRate, isOffline, input, { numSamples });
+
+            beginTest(juce::String("The detector moves the bell (") + (isOffline ? "offline" : "realtime") + ")");
+            {
+                auto staticPeak = dynamicPeak;
+                staticPeak.push_back({ Parameters::getID(Parameters::PeakDynamic), 0.f });
+
+                expect(!isIdentical(whole, TestRendering::render(staticPeak, sampleRate, isOffline, input, { numSamples })),
+                       "the dynamic peak sounds the same as the static one, so this test proves nothing");
+            }
+
+            beginTest(juce::String("Block splits give identical output (") + (isOffline ? "offline" : "realtime") + ")");
+            {
+                //none of these line up with the control interval
+                const std::vector<std::vector<int>> splits = { { 1 }, { 31 }, { 33 }, { 480 }, { 1, 100, 7, 513, 2, 64 } };
+
+                for (const auto& blockSizes : splits)
+                {
+                    juce::StringArray sizes;
+                    for (auto size : blockSizes)
+                        sizes.add(juce::String(size));
+
+                    expect(isIdentical(whole, TestRendering::render(dynamicPeak, sampleRate, isOffline, input, blockSizes)),
+                           "blocks of " + sizes.joinIntoString(", ") + " differ from a single block");
+                }
+            }
+        }
+    }
+};
+
+static DynamicPeakTests dynamicPeakTests;
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    Fifo: ordering, drop counting and the high-water mark, on one thread
+    and with a producer and a consumer running concurrently.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+struct FifoTests : juce::UnitTest
+{
+    FifoTests() : juce::UnitTest("Fifo", "SimpleEQ") {}
+
+    void runTest() override
+    {
+        beginTest("Filling up counts drops and the high-water mark");
+        {
+            Fifo<int, 8> fifo;
+            const auto capacity = fifo.getCapacity();
+
+            for (int i = 0; i < capacity; ++i)
+                expect(fifo.push(i));
+
+            expect(!fifo.push(capacity));
+            expect(!fifo.push(capacity + 1));
+            expectEquals(fifo.getNumDropped(), 2);
+            expectEquals(fifo.getHighWaterMark(), capacity);
+
+            int value = -1;
+            for (int i = 0; i < capacity; ++i)
+            {
+                expect(fifo.pull(value));
+                expectEquals(value, i);
+            }
+            expect(!fifo.pull(value));
+
+            fifo.resetStatistics();
+            expectEquals(fifo.getNumDropped(), 0);
+            expectEquals(fifo.getHighWaterMark(), 0);
+        }
+
+        beginTest("pull() hands back the slot's storage");
+        {
+            Fifo<juce::AudioBuffer<float>, 4> fifo;
+            fifo.prepare(2, 512);
+
+            const auto memoryUsage = fifo.getMemoryUsage();
+
+            juce::AudioBuffer<float> buffer(2, 512);
+            buffer.setSample(0, 0, 1.f);
+            const auto* storage = buffer.getReadPointer(0);
+
+            expect(fifo.push(buffer));
+            expect(fifo.pull(buffer));
+
+            expectEquals(buffer.getSample(0, 0), 1.f);
+            expect(buffer.getReadPointer(0) != storage, "the item was copied out instead of swapped");
+            expectEquals(buffer.getNumSamples(), 512);
+            expectEquals(fifo.getMemoryUsage(), memoryUsage);   //the slot kept a buffer of the same size
+        }
+
+        beginTest("A producer and a consumer on two threads");
+        {
+            constexpr int numItems = 200000;
+
+            Fifo<int, 8> fifo;
+            std::atomic<bool> isProducing{ true };
+            int numPushed = 0;
+
+            std::thread producer([&]
+                {
+                    for (int i = 0; i < numItems; ++i)
+                    {
+                        if (fifo.push(i))
+                            ++numPushed;
+
+                        if ((i & 63) == 0)
+                            std::this_thread::yield();
+                    }
+
+                    isProducing.store(false, std::memory_order_release);
+                });
+
+            std::vector<int> received;
+            received.reserve(numItems);
+
+            for (;;)
+            {
+                const auto wasProducing = isProducing.load(std::memory_order_acquire);
+
+                int value;
+                while (fifo.pull(value))
+                    received.push_back(value);
+
+                if (!wasProducing)
+                    break;
+
+                std::this_thread::yield();
+            }
+
+            producer.join();
+
+            //a full fifo drops the newest item, so what arrives is in order with gaps but no repeats
+            bool isOrdered = true;
+            for (size_t i = 1; i < received.size(); ++i)
+                isOrdered = isOrdered && received[i] > received[i - 1];
+
+            expect(isOrdered, "items arrived out of order or twice");
+            expectEquals((int)received.size(), numPushed);
+            expectEquals((int)received.size() + fifo.getNumDropped(), numItems);
+            expectGreaterOrEqual(fifo.getHighWaterMark(), 1);
+            expectLessOrEqual(fifo.getHighWaterMark(), fifo.getCapacity());
+
+            logMessage(juce::String(fifo.getNumDropped()) + " of " + juce::String(numItems) + " items dropped, high-water mark "
+                       + juce::String(fifo.getHighWaterMark()) + " of " + juce::String(fifo.getCapacity()));
+        }
+    }
+};
+
+static FifoTests fifoTests;
@@ -0,0 +1,318 @@
+/*
+  ==============================================================================
+
+    Golden-output regression tests: fixed signals rendered through the
+    processor over a matrix of settings, sample rates, engines and block
+    sizes, and compared with the references in Tests/References.
+
+    Run with --regenerate to (re)write the references after an intended
+    change to the sound, and commit them with that change.
+
+  ==============================================================================
+*/
+
+#include "TestRendering.h"
+#include "TestOptions.h"
+
+namespace
+{
+    struct GoldenCase
+    {
+        const char* name;
+        TestRendering::ParameterValues values;
+    };
+
+    juce::String id(Parameters::ID parameter) { return Parameters::getID(parameter); }
+
+    std::vector<GoldenCase> getGoldenCases()
+    {
+        using TestRendering::getBandID;
+
+        return
+        {
+            { "flat", {} },
+            { "cuts", { { id(Parameters::LowCutFreq), 120.f }, { id(Parameters::LowCutShape), (float)Shape_48 },
+                        { id(Parameters::HighCutFreq), 6000.f }, { id(Parameters::HighCutShape), (float)Shape_24 } } },
+            { "cut-families", { { id(Parameters::LowCutFreq), 200.f }, { id(Parameters::LowCutExtendedSlope), (float)ExtendedSlope_96 },
+                                { id(Parameters::LowCutType), (float)LinkwitzRiley },
+                                { id(Parameters::HighCutFreq), 4000.f }, { id(Parameters::HighCutExtendedSlope), (float)ExtendedSlope_72 },
+                                { id(Parameters::HighCutType), (float)Elliptic } } },
+            { "peak", { { id(Parameters::PeakFreq), 1000.f }, { id(Parameters::PeakGain), 9.f }, { id(Parameters::PeakQ), 2.f } } },
+            { "dynamic-peak", { { id(Parameters::PeakFreq), 1000.f }, { id(Parameters::PeakGain), 6.f }, { id(Parameters::PeakQ), 1.5f },
+                                { id(Parameters::PeakDynamic), 1.f }, { id(Parameters::PeakThreshold), -30.f },
+                                { id(Parameters::PeakRatio), 4.f }, { id(Parameters::PeakAttack), 5.f },
+                                { id(Parameters::PeakRelease), 50.f } } },
+            { "mid-side", { { id(Parameters::StereoMode), (float)StereoMode::MidSide },
+                            { id(Parameters::PeakFreq), 500.f }, { id(Parameters::PeakGain), 4.f },
+                            { id(Parameters::SidePeakFreq), 3000.f }, { id(Parameters::SidePeakGain), -6.f },
+                            { id(Parameters::SideLowCutFreq), 250.f } } },
+            //a band as well, which has to leave the other component alone just like the chain
+            { "mid-only", { { id(Parameters::StereoMode), (float)StereoMode::MidOnly },
+                            { id(Parameters::PeakFreq), 500.f }, { id(Parameters::PeakGain), 4.f },
+                            { getBandID(0, Parameters::BandEnable), 1.f }, { getBandID(0, Parameters::BandType), (float)HighShelf },
+                            { getBandID(0, Parameters::BandFreq), 5000.f }, { getBandID(0, Parameters::BandGain), 6.f } } },
+            { "side-only", { { id(Parameters::StereoMode), (float)StereoMode::SideOnly },
+                             { id(Parameters::PeakFreq), 500.f }, { id(Parameters::PeakGain), 4.f },
+                             { getBandID(0, Parameters::BandEnable), 1.f }, { getBandID(0, Parameters::BandType), (float)HighShelf },
+                             { getBandID(0, Parameters::BandFreq), 5000.f }, { getBandID(0, Parameters::BandGain), 6.f } } },
+            { "bands", { { getBandID(0, Parameters::BandEnable), 1.f }, { getBandID(0, Parameters::BandType), (float)Bell },
+                         { getBandID(0, Parameters::BandFreq), 300.f }, { getBandID(0, Parameters::BandGain), 5.f },
+                         { getBandID(0, Parameters::BandQ), 2.f },
+                         { getBandID(1, Parameters::BandEnable), 1.f }, { getBandID(1, Parameters::BandType), (float)HighShelf },
+                         { getBandID(1, Parameters::BandFreq), 8000.f }, { getBandID(1, Parameters::BandGain), -4.f },
+                         { getBandID(2, Parameters::BandEnable), 1.f }, { getBandID(2, Parameters::BandType), (float)Notch },
+                         { getBandID(2, Parameters::BandFreq), 60.f }, { getBandID(2, Parameters::BandQ), 5.f } } }
+        };
+    }
+
+    struct EngineConfig
+    {
+        double sampleRate;
+        bool isOffline;
+    };
+
+    constexpr EngineConfig engineConfigs[] = { { 44100.0, false }, { 48000.0, false }, { 96000.0, false }, { 48000.0, true } };
+    constexpr TestRendering::Signal signals[] = { TestRendering::Signal::Impulse, TestRendering::Signal::Sweep, TestRendering::Signal::Noise };
+
+    constexpr int numSamples = 4096;
+    constexpr int referenceBlockSize = 512;
+
+    //the other block sizes must reproduce the reference too: a power of two, an odd size and single samples
+    const std::vector<std::vector<int>> otherBlockSizes = { { 64 }, { 441 }, { 1 } };
+
+    //host-style irregular splits, compared with one render in a single block
+    const std::vector<std::vector<int>> irregularBlockSizes = { { 1, 7, 64, 13, 512, 3, 100 }, { 333, 17, 2, 256 } };
+
+    /*
+     Where the silence sleep cuts a ringing tail off depends on the block size, and it does so once the
+     tail is estimated to be below -120 dB. The estimate is rough, so once the input has ended, differences
+     below -100 dBFS are taken as matching. Everything before that, and everything above the floor, has to
+     meet the tolerance.
+     */
+    constexpr float silenceFloor = 1.0e-5f;
+
+    //the first sample from which the input is silent on every channel: where the silence sleep may start
+    int getSilenceStart(const juce::AudioBuffer<float>& input)
+    {
+        int start = 0;
+
+        for (int ch = 0; ch < input.getNumChannels(); ++ch)
+            for (int i = input.getNumSamples(); i > start; --i)
+                if (input.getSample(ch, i - 1) != 0.f)
+                {
+                    start = i;
+                    break;
+                }
+
+        return start;
+    }
+
+    juce::int64 getUlpDistance(float a, float b)
+    {
+        //maps the float bit patterns onto integers in the same order as the values
+        auto toOrdered = [](float f)
+            {
+                juce::int32 bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                return bits < 0 ? (juce::int64)std::numeric_limits<juce::int32>::min() - bits : (juce::int64)bits;
+            };
+
+        return std::abs(toOrdered(a) - toOrdered(b));
+    }
+
+    struct Comparison
+    {
+        int numMismatches{ 0 };
+        int firstChannel{ -1 }, firstSample{ -1 };
+        juce::int64 maxUlps{ 0 };
+        double maxErrorDecibels{ -std::numeric_limits<double>::infinity() };
+
+        juce::String getDescription() const
+        {
+            return juce::String(numMismatches) + " samples differ, the first at channel " + juce::String(firstChannel)
+                 + " sample " + juce::String(firstSample) + "; worst " + juce::String(maxUlps) + " ULPs, "
+                 + juce::String(maxErrorDecibels, 1) + " dB below the reference's peak";
+        }
+    };
+
+    Comparison compare(const juce::AudioBuffer<float>& rendered, const juce::AudioBuffer<float>& reference, int maxUlps, double maxErrorDecibels,
+                       int silenceStart)
+    {
+        Comparison result;
+
+        const auto peak = reference.getMagnitude(0, reference.getNumSamples());
+        const auto maxError = std::isfinite(maxErrorDecibels) ? peak * juce::Decibels::decibelsToGain((float)maxErrorDecibels, -1000.f) : 0.f;
+
+        for (int ch = 0; ch < reference.getNumChannels(); ++ch)
+        {
+            for (int i = 0; i < reference.getNumSamples(); ++i)
+            {
+                const auto a = rendered.getSample(ch, i), b = reference.getSample(ch, i);
+                const auto difference = std::abs(a - b);
+                const auto ulps = std::isnan(a) || std::isnan(b) ? std::numeric_limits<juce::int64>::max() : getUlpDistance(a, b);
+
+                if (ulps <= maxUlps || difference <= maxError || (i >= silenceStart && difference <= silenceFloor))
+                    continue;
+
+                if (result.numMismatches++ == 0)
+                {
+                    result.firstChannel = ch;
+                    result.firstSample = i;
+                }
+
+                result.maxUlps = juce::jmax(result.maxUlps, ulps);
+                if (peak > 0.f)
+                    result.maxErrorDecibels = juce::jmax(result.maxErrorDecibels, (double)juce::Decibels::gainToDecibels(difference / peak, -1000.f));
+            }
+        }
+
+        return result;
+    }
+
+    //"SEQG", then the channel and sample counts as 32-bit ints and the samples as little-endian floats, channel by channel
+    bool writeReference(const juce::File& file, const juce::AudioBuffer<float>& buffer)
+    {
+        if (file.getParentDirectory().createDirectory().failed())
+            return false;
+
+        file.deleteFile();
+        juce::FileOutputStream stream(file);
+        if (stream.failedToOpen())
+            return false;
+
+        stream.write("SEQG", 4);
+        stream.writeInt(buffer.getNumChannels());
+        stream.writeInt(buffer.getNumSamples());
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                stream.writeFloat(buffer.getSample(ch, i));
+
+        stream.flush();
+        return stream.getStatus().wasOk();
+    }
+
+    bool readReference(const juce::File& file, juce::AudioBuffer<float>& buffer)
+    {
+        juce::MemoryBlock data;
+        if (!file.loadFileAsData(data) || data.getSize() < 12 || std::memcmp(data.getData(), "SEQG", 4) != 0)
+            return false;
+
+        juce::MemoryInputStream stream(data, false);
+        stream.skipNextBytes(4);
+
+        const auto numChannels = stream.readInt();
+        const auto numStored = stream.readInt();
+        if (numChannels <= 0 || numStored <= 0 || data.getSize() != 12 + (size_t)numChannels * (size_t)numStored * sizeof(float))
+            return false;
+
+        buffer.setSize(numChannels, numStored);
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int i = 0; i < numStored; ++i)
+                buffer.setSample(ch, i, stream.readFloat());
+
+        return true;
+    }
+}
+
+struct GoldenOutputTests : juce::UnitTest
+{
+    GoldenOutputTests() : juce::UnitTest("Golden output", "SimpleEQ") {}
+
+    void runTest() override
+    {
+        const auto& options = getTestOptions();
+
+        for (const auto& goldenCase : getGoldenCases())
+        {
+            for (const auto& config : engineConfigs)
+            {
+                for (auto signal : signals)
+                {
+                    const auto name = juce::String(goldenCase.name) + "_" + (config.isOffline ? "offline" : "realtime") + "_"
+                                    + juce::String((int)config.sampleRate) + "_" + TestRendering::getName(signal);
+                    beginTest(name);
+
+                    const auto input = TestRendering::makeSignal(signal, config.sampleRate, numSamples);
+                    const auto rendered = TestRendering::render(goldenCase.values, config.sampleRate, config.isOffline, input, { referenceBlockSize });
+                    const auto file = options.referenceDirectory.getChildFile(name + ".bin");
+
+                    juce::AudioBuffer<float> reference;
+
+                    if (options.shouldRegenerateReferences)
+                    {
+                        expect(writeReference(file, rendered), "couldn't write " + file.getFullPathName());
+                        reference = rendered;
+                    }
+                    else if (!readReference(file, reference))
+                    {
+                        expect(false, "no reference at " + file.getFullPathName() + ": run with --regenerate to create it");
+                        continue;
+                    }
+
+                    expectEquals(reference.getNumChannels(), rendered.getNumChannels());
+                    expectEquals(reference.getNumSamples(), rendered.getNumSamples());
+                    if (reference.getNumChannels() != rendered.getNumChannels() || reference.getNumSamples() != rendered.getNumSamples())
+                        continue;
+
+                    auto check = [&](const juce::AudioBuffer<float>& output, const juce::String& what)
+                        {
+                            const auto comparison = compare(output, reference, options.maxUlps, options.maxErrorDecibels, getSilenceStart(input));
+                            expect(comparison.numMismatches == 0, what + ": " + comparison.getDescription());
+                        };
+
+                    check(rendered, "blocks of " + juce::String(referenceBlockSize));
+
+                    for (const auto& blockSizes : otherBlockSizes)
+                        check(TestRendering::render(goldenCase.values, config.sampleRate, config.isOffline, input, blockSizes),
+                              "blocks of " + juce::String(blockSizes.front()));
+                }
+            }
+        }
+
+        //independent of the references: however the host splits its buffers, the output is the same to the bit,
+        //apart from where the silence sleep cuts a tail off
+        for (const auto& goldenCase : getGoldenCases())
+        {
+            beginTest(juce::String("Block-split identity: ") + goldenCase.name);
+
+            for (auto signal : signals)
+            {
+                const auto input = TestRendering::makeSignal(signal, 48000.0, numSamples);
+                const auto whole = TestRendering::render(goldenCase.values, 48000.0, false, input, { numSamples });
+
+                for (const auto& blockSizes : irregularBlockSizes)
+                {
+                    const auto split = TestRendering::render(goldenCase.values, 48000.0, false, input, blockSizes);
+                    const auto comparison = compare(split, whole, 0, -std::numeric_limits<double>::infinity(), getSilenceStart(input));
+                    expect(comparison.numMismatches == 0, juce::String(TestRendering::getName(signal)) + ": " + comparison.getDescription());
+                }
+            }
+        }
+
+        //also independent of the references: Mid Only and Side Only pass the other component through, bands included
+        for (const auto& goldenCase : getGoldenCases())
+        {
+            const juce::String name(goldenCase.name);
+            if (name != "mid-only" && name != "side-only")
+                continue;
+
+            beginTest("Untouched component: " + name);
+
+            const auto input = TestRendering::makeSignal(TestRendering::Signal::Noise, 48000.0, numSamples);
+            const auto output = TestRendering::render(goldenCase.values, 48000.0, false, input, { referenceBlockSize });
+
+            //L - R is twice Side and L + R twice Mid
+            const auto sign = name == "mid-only" ? -1.f : 1.f;
+            auto maxDifference = 0.f;
+
+            for (int i = 0; i < numSamples; ++i)
+                maxDifference = juce::jmax(maxDifference, std::abs((input.getSample(0, i) + sign * input.getSample(1, i))
+                                                                 - (output.getSample(0, i) + sign * output.getSample(1, i))));
+
+            expectLessThan(maxDifference, 1.0e-6f);
+        }
+    }
+};
+
+static GoldenOutputTests goldenOutputTests;
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    Headless test runner for the SimpleEQ processor.
+
+    SimpleEQTests                       runs every test
+      --category=<name>                 only the tests in one category
+      --references=<directory>          golden outputs to compare against
+                                        (default: Tests/References)
+      --regenerate                      rewrite the golden outputs instead
+      --max-ulps=<n>                    golden output tolerance in ULPs (default 0)
+      --max-error-db=<dB>               or in dB below the reference's peak
+
+    Exits with 1 if any test failed.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "TestOptions.h"
+
+TestOptions& getTestOptions()
+{
+    static TestOptions options;
+    return options;
+}
+
+int main(int argc, char* argv[])
+{
+    //the processor posts async updates, so it needs a message manager even without a GUI
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    const juce::ArgumentList args(argc, argv);
+
+    auto& options = getTestOptions();
+    options.referenceDirectory = args.containsOption("--references")
+                                     ? juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--references"))
+                                     : juce::File::getCurrentWorkingDirectory().getChildFile(__FILE__).getParentDirectory()
+                                                                               .getSiblingFile("References");
+    options.shouldRegenerateReferences = args.containsOption("--regenerate");
+
+    if (args.containsOption("--max-ulps"))
+        options.maxUlps = args.getValueForOption("--max-ulps").getIntValue();
+    if (args.containsOption("--max-error-db"))
+        options.maxErrorDecibels = args.getValueForOption("--max-error-db").getDoubleValue();
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+
+    if (args.containsOption("--category"))
+        runner.runTestsInCategory(args.getValueForOption("--category"));
+    else
+        runner.runAllTests();
+
+    int numFailures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult(i)->failures;
+
+    return numFailures > 0 ? 1 : 0;
+}
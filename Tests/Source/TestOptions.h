@@ -0,0 +1,26 @@
+/*
+  ==============================================================================
+
+    Command-line options for the tests, filled in by main() before any of
+    them run.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct TestOptions
+{
+    juce::File referenceDirectory;           //where the golden outputs are stored
+    bool shouldRegenerateReferences{ false };
+
+    //a rendered sample matches its reference if it is within maxUlps of it, or, when maxErrorDecibels
+    //is set, if the difference is at most that far below the reference's peak. The defaults are
+    //bit-exact, which is what the scalar path must meet; SIMD or fast-math builds pass looser bounds.
+    int maxUlps{ 0 };
+    double maxErrorDecibels{ -std::numeric_limits<double>::infinity() };
+};
+
+TestOptions& getTestOptions();
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    Helpers for rendering signals through SimpleEQAudioProcessor the way a
+    host would: parameters set through the APVTS, then processBlock() in
+    whatever block sizes are asked for.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+namespace TestRendering
+{
+    //parameter IDs and their values in plain units
+    using ParameterValues = std::vector<std::pair<juce::String, float>>;
+
+    inline juce::String getBandID(int bandIndex, Parameters::BandID id)
+    {
+        return SimpleEQAudioProcessor::getBandParameterID(bandIndex, Parameters::bandParameterTable[(size_t)id].id);
+    }
+
+    inline void setParameters(SimpleEQAudioProcessor& processor, const ParameterValues& values)
+    {
+        for (const auto& [id, value] : values)
+        {
+            auto* param = processor.apvts.getParameter(id);
+            jassert(param != nullptr);   //not a parameter ID
+            param->setValueNotifyingHost(param->convertTo0to1(value));
+        }
+    }
+
+    //offline selects the oversampled engine, as a host rendering a bounce would
+    inline void prepare(SimpleEQAudioProcessor& processor, double sampleRate, int maximumBlockSize, bool isOffline)
+    {
+        processor.setNonRealtime(isOffline);
+        processor.setRateAndBufferSizeDetails(sampleRate, maximumBlockSize);
+        processor.prepareToPlay(sampleRate, maximumBlockSize);
+    }
+
+    //processes 'buffer' in place in consecutive blocks of the given sizes, repeating the pattern until it is used up
+    inline void process(SimpleEQAudioProcessor& processor, juce::AudioBuffer<float>& buffer, const std::vector<int>& blockSizes)
+    {
+        juce::MidiBuffer midi;
+
+        for (int start = 0, i = 0; start < buffer.getNumSamples(); ++i)
+        {
+            const auto numSamples = juce::jmin(blockSizes[(size_t)i % blockSizes.size()], buffer.getNumSamples() - start);
+
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, numSamples);
+            processor.processBlock(block, midi);
+
+            start += numSamples;
+        }
+    }
+
+    //a fresh processor, so every render starts from the same state
+    inline juce::AudioBuffer<float> render(const ParameterValues& values, double sampleRate, bool isOffline,
+                                           const juce::AudioBuffer<float>& input, const std::vector<int>& blockSizes)
+    {
+        SimpleEQAudioProcessor processor;
+        setParameters(processor, values);
+        prepare(processor, sampleRate, *std::max_element(blockSizes.begin(), blockSizes.end()), isOffline);
+
+        auto output = input;
+        process(processor, output, blockSizes);
+        return output;
+    }
+
+    enum class Signal { Impulse, Sweep, Noise };
+
+    inline const char* getName(Signal signal)
+    {
+        switch (signal)
+        {
+            case Signal::Impulse: return "impulse";
+            case Signal::Sweep: return "sweep";
+            case Signal::Noise: return "noise";
+        }
+
+        return "";
+    }
+
+    //stereo, with different left and right channels so the Mid/Side modes have both to work on
+    inline juce::AudioBuffer<float> makeSignal(Signal signal, double sampleRate, int numSamples)
+    {
+        juce::AudioBuffer<float> buffer(2, numSamples);
+        buffer.clear();
+
+        switch (signal)
+        {
+            case Signal::Impulse:
+                buffer.setSample(0, 0, 1.f);
+                buffer.setSample(1, juce::jmin(100, numSamples - 1), -0.5f);
+                break;
+
+            case Signal::Sweep:
+            {
+                //exponential sine sweep from 20 Hz to just below Nyquist; the right channel runs a quarter cycle ahead
+                const auto start = 20.0, end = 0.45 * sampleRate;
+                const auto duration = numSamples / sampleRate;
+                const auto rate = std::log(end / start);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const auto t = i / sampleRate;
+                    const auto phase = juce::MathConstants<double>::twoPi * start * duration / rate * (std::exp(t / duration * rate) - 1.0);
+                    buffer.setSample(0, i, 0.5f * (float)std::sin(phase));
+                    buffer.setSample(1, i, 0.25f * (float)std::cos(phase));
+                }
+                break;
+            }
+
+            case Signal::Noise:
+            {
+                juce::Random random(0x5eed);
+                for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                    for (int i = 0; i < numSamples; ++i)
+                        buffer.setSample(ch, i, 0.5f * (random.nextFloat() * 2.f - 1.f));
+                break;
+            }
+        }
+
+        return buffer;
+    }
+}